@@ -24,6 +24,7 @@
 #define JSCON_PUBLIC_H_
 
 #include <stddef.h>
+#include <stdint.h>
 #include <stdbool.h>
 
 
@@ -45,12 +46,140 @@ enum jscon_type {
 };
 
 
+/* jscon_parse_ex() option flags */
+enum jscon_parse_flags {
+    JSCON_PARSE_DEFAULT         = 0,
+    /* keep number's source text, convert it at first getter call */
+    JSCON_PARSE_LAZY_NUMBER     = 1 << 0,
+    /* same-keyed objects in an array share a single key index */
+    JSCON_PARSE_SHARE_SHAPES    = 1 << 1,
+    /* arrays of only numbers or only booleans are stored as vectors */
+    JSCON_PARSE_PACK_ARRAYS     = 1 << 2,
+};
+
+/* jscon_clone_ex() option flags */
+enum jscon_clone_flags {
+    JSCON_CLONE_DEFAULT         = 0,
+    /* frozen item's branches are cloned on access */
+    JSCON_CLONE_SHARE           = 1 << 0,
+};
+
+/* jscon_parse_ex() error codes */
+enum jscon_parse_errcode {
+    JSCON_PARSE_OK              = 0,
+    /* out of memory, or memory block exhausted */
+    JSCON_PARSE_ERR_MEM         = -1,
+    /* jscon_parse_limits_t exceeded */
+    JSCON_PARSE_ERR_DEPTH       = -2,
+    JSCON_PARSE_ERR_NODES       = -3,
+    JSCON_PARSE_ERR_BYTES       = -4,
+    JSCON_PARSE_ERR_STRING      = -5,
+};
+
+/* jscon_parse_ex() resource limits, 0 for unlimited
+ *  max_depth: maximum nesting of objects and arrays
+ *  max_nodes: maximum amount of values (nested ones included)
+ *  max_bytes: maximum amount of bytes allocated for the tree
+ *  max_string_len: maximum length of a single string or key */
+typedef struct jscon_parse_limits_s {
+    size_t max_depth;
+    size_t max_nodes;
+    size_t max_bytes;
+    size_t max_string_len;
+} jscon_parse_limits_t;
+
+/* jscon_parse_ex() options, zero-initialize for jscon_parse() defaults
+ *  flags: bitmask of enum jscon_parse_flags
+ *  mem: memory block where the tree is placed, instead of the heap
+ *      (NULL for heap)
+ *  mem_size: the memory block size (check jscon_mem_size())
+ *  limits: resource limits, the parse is abandoned if exceeded
+ *  errcode: set by jscon_parse_ex() (check enum jscon_parse_errcode) */
+typedef struct jscon_parse_opt_s {
+    int flags;
+
+    void *mem;
+    size_t mem_size;
+
+    jscon_parse_limits_t limits;
+
+    int errcode;
+} jscon_parse_opt_t;
+
+
+/* jscon_parse_step() return status */
+enum jscon_parse_status {
+    JSCON_PARSE_DONE            = 0, /* the whole buffer has been parsed */
+    JSCON_PARSE_MORE            = 1, /* budget exhausted, step again */
+    JSCON_PARSE_ERROR           = 2, /* a resource limit was exceeded */
+};
+
+
+/* pre-hashed key, for repeated lookups of a same key (check jscon_key())
+ *  str: the key, must outlive the handle
+ *  len: the key length
+ *  hash: the key hash, only valid for the running process
+ *  hint: the branch index key was last found at, tried first by
+ *      the next lookup, as same-shaped objects share positions.
+ *      lookups write to it, so a handle is not to be shared
+ *      between threads */
+typedef struct jscon_key_s {
+    const char *str;
+    size_t len;
+    uint64_t hash;
+    size_t hint;
+} jscon_key_t;
+
+
 /* forwarding, definition at jscon-common.h */
 typedef struct jscon_item_s jscon_item_t;
+/* forwarding, definition at jscon-parser.c */
+typedef struct jscon_parser_s jscon_parser_t;
+/* forwarding, definition at jscon-stream.c */
+typedef struct jscon_array_stream_s jscon_array_stream_t;
+/* forwarding, definition at jscon-doc.c */
+typedef struct jscon_doc_s jscon_doc_t;
+typedef struct jscon_doc_slot_s jscon_doc_slot_t;
+/* forwarding, definition at sys/uio.h */
+struct iovec;
 /* jscon_parser() callback */
 typedef jscon_item_t* (jscon_cb)(jscon_item_t*);
 
 
+/* jscon_cursor_init() traversal modes */
+enum jscon_cursor_mode {
+    /* every nested item, in preorder (same order as jscon_iter_next()) */
+    JSCON_CURSOR_PREORDER       = 0,
+    /* the item's branches only */
+    JSCON_CURSOR_CHILDREN       = 1,
+};
+
+#define JSCON_CURSOR_LOCAL_DEPTH 8
+
+/* caller-owned traversal state, so that the tree itself isn't written
+ *  to while iterated (check jscon_cursor_init()). its fields are
+ *  private:
+ *      root: the item being iterated
+ *      mode: the traversal mode (check enum jscon_cursor_mode)
+ *      local: composites being iterated, along with the index of their
+ *          next branch to be visited
+ *      stack: same as local, allocated once the nesting gets deeper
+ *          than JSCON_CURSOR_LOCAL_DEPTH (NULL until then)
+ *      depth: amount of composites being iterated
+ *      max_depth: amount of stack frames allocated */
+typedef struct jscon_cursor_s {
+    jscon_item_t *root;
+    int mode;
+
+    struct jscon_cursor_frame_s {
+        jscon_item_t *item;
+        size_t index;
+    } local[JSCON_CURSOR_LOCAL_DEPTH], *stack;
+    size_t depth;
+    size_t max_depth;
+} jscon_cursor_t;
+
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -72,21 +201,53 @@ void jscon_destroy(jscon_item_t *item);
 /* JSCON DECODING
  * parse buffer and returns a jscon item */
 jscon_item_t* jscon_parse(char *buffer);
+jscon_item_t* jscon_parse_ex(char *buffer, jscon_parse_opt_t *opt);
+size_t jscon_mem_size(size_t max_nodes, size_t max_string_bytes);
+jscon_item_t* jscon_parse_iov(const struct iovec *iov, int iovcnt);
+jscon_parser_t* jscon_parser_init(char *buffer, const jscon_parse_opt_t *opt);
+enum jscon_parse_status jscon_parse_step(jscon_parser_t *parser, size_t max_bytes);
+enum jscon_parse_status jscon_parse_step_ns(jscon_parser_t *parser, long long max_ns);
+jscon_item_t* jscon_parser_finish(jscon_parser_t *parser);
+int jscon_parser_errcode(const jscon_parser_t *parser);
+jscon_item_t* jscon_reparse(jscon_item_t *root, char *buffer, size_t edit_offset, size_t old_len, size_t new_len);
+size_t jscon_parse_update(jscon_item_t *root, char *buffer, jscon_cb *changed_cb);
+/* parse a top-level array one element at a time */
+jscon_array_stream_t* jscon_array_stream_open(int fd, bool read_ahead);
+jscon_array_stream_t* jscon_array_stream_open_buffer(char *buffer, size_t len);
+jscon_item_t* jscon_array_stream_next(jscon_array_stream_t *stream);
+void jscon_array_stream_close(jscon_array_stream_t *stream);
 jscon_cb* jscon_parse_cb(jscon_cb *new_cb);
 /* only parse json values from given parameters */
 void jscon_scanf(char *buffer, char *format, ...);
  
 /* JSCON ENCODING */
 char* jscon_stringify(jscon_item_t *root, enum jscon_type type);
+/* strip whitespace outside of strings, dest may be the same as src */
+size_t jscon_minify(char *dest, const char *src, size_t len);
+
+/* JSCON VALIDATION
+ * check buffer's grammar without building a jscon item */
+bool jscon_validate(const char *buffer, size_t len, size_t *p_err_offset);
 
 /* JSCON UTILITIES */
 size_t jscon_size(const jscon_item_t* item);
 jscon_item_t* jscon_append(jscon_item_t *item, jscon_item_t *new_branch);
+jscon_item_t* jscon_reserve(jscon_item_t *item, size_t num_branch);
+/* make tree read-only, with perfect hashed object lookups */
+bool jscon_freeze(jscon_item_t *root);
 jscon_item_t* jscon_dettach(jscon_item_t *item);
 void jscon_delete(jscon_item_t *item, const char *key);
 jscon_item_t* jscon_iter_composite_r(jscon_item_t *item, jscon_item_t **p_current_item);
 jscon_item_t* jscon_iter_next(jscon_item_t* item);
+/* iterate without modifying the tree, safe for concurrent readers */
+void jscon_cursor_init(jscon_cursor_t *cursor, jscon_item_t *item, int mode);
+jscon_item_t* jscon_cursor_next(jscon_cursor_t *cursor);
+bool jscon_cursor_next_pair(jscon_cursor_t *cursor, const char **p_key, jscon_item_t **p_value);
+void jscon_cursor_cleanup(jscon_cursor_t *cursor);
 jscon_item_t* jscon_clone(jscon_item_t *item);
+jscon_item_t* jscon_clone_ex(jscon_item_t *item, int flags);
+/* new version of a frozen tree, that only copies the path to an item */
+jscon_item_t* jscon_version_edit(jscon_item_t *root, const char *path[], size_t depth, jscon_item_t **p_item);
 char* jscon_typeof(const jscon_item_t* item);
 char* jscon_strdup(const jscon_item_t* item);
 char* jscon_strcpy(char *dest, const jscon_item_t* item);
@@ -95,9 +256,24 @@ int jscon_keycmp(const jscon_item_t* item, const char *key);
 int jscon_doublecmp(const jscon_item_t* item, const double d_number);
 int jscon_intcmp(const jscon_item_t* item, const long long i_number);
 
+/* JSCON DOCUMENTS
+ * reference counted frozen trees, safe to be shared by threads */
+jscon_doc_t* jscon_doc_init(jscon_item_t *root);
+jscon_doc_t* jscon_doc_retain(jscon_doc_t *doc);
+void jscon_doc_release(jscon_doc_t *doc);
+const jscon_item_t* jscon_doc_root(const jscon_doc_t *doc);
+const jscon_item_t* jscon_doc_get_branch(const jscon_item_t *item, const char *key);
+/* hot-swappable current version of a document */
+jscon_doc_slot_t* jscon_doc_slot_init(jscon_doc_t *doc);
+void jscon_doc_slot_destroy(jscon_doc_slot_t *slot);
+jscon_doc_t* jscon_doc_acquire(jscon_doc_slot_t *slot);
+void jscon_doc_swap(jscon_doc_slot_t *slot, jscon_doc_t *new_doc);
+
 /* JSCON GETTERS */
 jscon_item_t* jscon_get_root(jscon_item_t* item);
 jscon_item_t* jscon_get_branch(jscon_item_t* item, const char *key);
+jscon_key_t jscon_key(const char *key);
+jscon_item_t* jscon_get_branch_k(jscon_item_t* item, jscon_key_t *key);
 jscon_item_t* jscon_get_sibling(const jscon_item_t* item, const size_t relative_index);
 jscon_item_t* jscon_get_parent(const jscon_item_t* item);
 jscon_item_t* jscon_get_byindex(const jscon_item_t* item, const size_t index);
@@ -108,6 +284,9 @@ bool jscon_get_boolean(const jscon_item_t* item);
 char* jscon_get_string(const jscon_item_t* item);
 double jscon_get_double(const jscon_item_t* item);
 long long jscon_get_integer(const jscon_item_t* item);
+bool jscon_get_integers(const jscon_item_t* item, long long **p_array, size_t *p_len);
+bool jscon_get_doubles(const jscon_item_t* item, double **p_array, size_t *p_len);
+bool jscon_get_booleans(const jscon_item_t* item, bool **p_array, size_t *p_len);
 
 /* JSCON SETTERS */
 jscon_item_t* jscon_set_boolean(jscon_item_t* item, bool boolean);
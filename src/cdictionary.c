@@ -0,0 +1,449 @@
+/*
+ * Copyright (c) 2020 Lucas Müller
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <sched.h>
+
+#include "cdictionary.h"
+#include "hashtable.h"
+
+/* slot of a removed entry, probing goes on past it */
+static cdictionary_entry_t cdictionary_deleted;
+#define DELETED (&cdictionary_deleted)
+
+/* maximum load factor of 3/4, counting deleted slots, so that probing
+      always ends at an empty slot */
+#define MAX_LOAD(num_bucket) ((num_bucket) - (num_bucket)/4)
+
+#define MIN_BUCKET 16
+
+
+static cdictionary_table_t*
+_cdictionary_table_init(size_t num_bucket)
+{
+    cdictionary_table_t *new_table = calloc(1, sizeof *new_table + num_bucket * sizeof *new_table->slot);
+    assert(NULL != new_table);
+
+    new_table->num_bucket = num_bucket;
+    for (size_t i=0; i < num_bucket; ++i){
+        atomic_init(&new_table->slot[i], NULL);
+    }
+
+    return new_table;
+}
+
+static void
+_cdictionary_entry_destroy(cdictionary_entry_t *entry)
+{
+    /* free value if its tagged for freeing */
+    if (entry->free_cb && NULL != entry->value){
+        (*entry->free_cb)(entry->value);
+    }
+
+    free(entry->key);
+    entry->key = NULL;
+
+    free(entry);
+}
+
+cdictionary_t*
+cdictionary_init(size_t num_shard)
+{
+    /* round up to a power of two */
+    size_t pow2 = 1;
+    unsigned shard_bits = 0;
+    while (pow2 < num_shard){
+        pow2 <<= 1;
+        ++shard_bits;
+    }
+
+    cdictionary_t *new_cdictionary = calloc(1, sizeof *new_cdictionary);
+    assert(NULL != new_cdictionary);
+
+    new_cdictionary->shard = calloc(pow2, sizeof *new_cdictionary->shard);
+    assert(NULL != new_cdictionary->shard);
+    new_cdictionary->num_shard = pow2;
+    new_cdictionary->shard_shift = 64 - shard_bits;
+
+    for (size_t i=0; i < pow2; ++i){
+        pthread_mutex_init(&new_cdictionary->shard[i].lock, NULL);
+        atomic_init(&new_cdictionary->shard[i].table, _cdictionary_table_init(MIN_BUCKET));
+    }
+
+    atomic_init(&new_cdictionary->len, 0);
+    atomic_init(&new_cdictionary->epoch, 0);
+    for (size_t i=0; i < CDICTIONARY_STRIPES; ++i){
+        atomic_init(&new_cdictionary->reader[i].count[0], 0);
+        atomic_init(&new_cdictionary->reader[i].count[1], 0);
+    }
+    pthread_mutex_init(&new_cdictionary->retire_lock, NULL);
+    pthread_mutex_init(&new_cdictionary->sync_lock, NULL);
+
+    return new_cdictionary;
+}
+
+static void
+_cdictionary_retired_destroy(cdictionary_retired_t *retired)
+{
+    while (NULL != retired){
+        cdictionary_retired_t *next = retired->next;
+
+        if (retired->is_entry){
+            _cdictionary_entry_destroy(retired->ptr);
+        } else {
+            free(retired->ptr);
+        }
+        free(retired);
+
+        retired = next;
+    }
+}
+
+/* destroys keys and values aswell, there must be no other threads
+    using it */
+void
+cdictionary_destroy(cdictionary_t *cdictionary)
+{
+    for (size_t i=0; i < cdictionary->num_shard; ++i){
+        cdictionary_shard_t *shard = &cdictionary->shard[i];
+        cdictionary_table_t *table = atomic_load(&shard->table);
+
+        for (size_t j=0; j < table->num_bucket; ++j){
+            cdictionary_entry_t *entry = atomic_load(&table->slot[j]);
+            if (NULL != entry && DELETED != entry){
+                _cdictionary_entry_destroy(entry);
+            }
+        }
+        free(table);
+
+        pthread_mutex_destroy(&shard->lock);
+    }
+    free(cdictionary->shard);
+
+    _cdictionary_retired_destroy(cdictionary->retired);
+
+    pthread_mutex_destroy(&cdictionary->retire_lock);
+    pthread_mutex_destroy(&cdictionary->sync_lock);
+
+    free(cdictionary);
+}
+
+/* amount of read sections the calling thread is in, for any
+    cdictionary, it must not wait for readers while in one */
+static _Thread_local unsigned cdictionary_depth;
+
+/* readers stripe of the calling thread */
+static unsigned
+_cdictionary_stripe()
+{
+    static atomic_uint num_thread;
+    static _Thread_local unsigned stripe; /* 0 if unassigned */
+
+    if (0 == stripe){
+        stripe = 1 + atomic_fetch_add(&num_thread, 1) % CDICTIONARY_STRIPES;
+    }
+    return stripe - 1;
+}
+
+/* start a read section, return a token to be given to
+    cdictionary_leave(). read sections may nest */
+unsigned
+cdictionary_enter(cdictionary_t *cdictionary)
+{
+    unsigned stripe = _cdictionary_stripe();
+    unsigned parity = atomic_load(&cdictionary->epoch) & 1;
+
+    atomic_fetch_add(&cdictionary->reader[stripe].count[parity], 1);
+    /* pairs with the fence at _cdictionary_wait_readers(), either
+        the reclaimer sees this reader, or this reader sees every
+        slot that was unlinked before the reclamation started */
+    atomic_thread_fence(memory_order_seq_cst);
+
+    ++cdictionary_depth;
+
+    return (stripe << 1) | parity;
+}
+
+void
+cdictionary_leave(cdictionary_t *cdictionary, unsigned token)
+{
+    --cdictionary_depth;
+    atomic_fetch_sub_explicit(&cdictionary->reader[token >> 1].count[token & 1], 1, memory_order_release);
+}
+
+/* move readers to the next epoch, and wait for the ones left at the
+    current one to leave */
+static void
+_cdictionary_wait_readers(cdictionary_t *cdictionary)
+{
+    unsigned parity = atomic_fetch_add(&cdictionary->epoch, 1) & 1;
+    atomic_thread_fence(memory_order_seq_cst);
+
+    for (size_t i=0; i < CDICTIONARY_STRIPES; ++i){
+        while (0 != atomic_load_explicit(&cdictionary->reader[i].count[parity], memory_order_acquire)){
+            sched_yield();
+        }
+    }
+}
+
+static void
+_cdictionary_reclaim(cdictionary_t *cdictionary)
+{
+    pthread_mutex_lock(&cdictionary->retire_lock);
+    cdictionary_retired_t *retired = cdictionary->retired;
+    cdictionary->retired = NULL;
+    cdictionary->num_retired = 0;
+    pthread_mutex_unlock(&cdictionary->retire_lock);
+
+    if (NULL == retired) return;
+
+    /* a reader may have read the epoch right before it moved, and
+        only then have counted itself in, at the now previous epoch.
+        by waiting for both epochs it can't be missed */
+    _cdictionary_wait_readers(cdictionary);
+    _cdictionary_wait_readers(cdictionary);
+
+    _cdictionary_retired_destroy(retired);
+}
+
+/* free what has been replaced or removed so far, once no reader can
+    reach it. must not be called from within a read section */
+void
+cdictionary_reclaim(cdictionary_t *cdictionary)
+{
+    assert(0 == cdictionary_depth);
+
+    pthread_mutex_lock(&cdictionary->sync_lock);
+    _cdictionary_reclaim(cdictionary);
+    pthread_mutex_unlock(&cdictionary->sync_lock);
+}
+
+/* hand ptr to be freed once no reader can reach it, return true if
+    enough memory has been retired for it to be reclaimed */
+static bool
+_cdictionary_retire(cdictionary_t *cdictionary, void *ptr, bool is_entry)
+{
+    cdictionary_retired_t *new_retired = malloc(sizeof *new_retired);
+    assert(NULL != new_retired);
+
+    new_retired->ptr = ptr;
+    new_retired->is_entry = is_entry;
+
+    pthread_mutex_lock(&cdictionary->retire_lock);
+    new_retired->next = cdictionary->retired;
+    cdictionary->retired = new_retired;
+    bool is_full = (++cdictionary->num_retired >= CDICTIONARY_RETIRE_BATCH);
+    pthread_mutex_unlock(&cdictionary->retire_lock);
+
+    return is_full;
+}
+
+/* reclaim if no other writer is already reclaiming, and this one
+    isn't reading (it would wait for itself) */
+static void
+_cdictionary_try_reclaim(cdictionary_t *cdictionary)
+{
+    if (0 != cdictionary_depth) return;
+    if (0 != pthread_mutex_trylock(&cdictionary->sync_lock)) return;
+    _cdictionary_reclaim(cdictionary);
+    pthread_mutex_unlock(&cdictionary->sync_lock);
+}
+
+static inline cdictionary_shard_t*
+_cdictionary_shard(cdictionary_t *cdictionary, uint64_t hash)
+{
+    /* 64 bit shifts are undefined, a single shard takes no bits */
+    if (1 == cdictionary->num_shard) return cdictionary->shard;
+    return &cdictionary->shard[hash >> cdictionary->shard_shift];
+}
+
+/* return the slot index of key, or -1 if it's not there. the entry
+    found is set at p_entry, as its slot may be swapped meanwhile. if
+    p_free is given, it's set to the first slot a new key could be
+    placed at */
+static long
+_cdictionary_find(cdictionary_table_t *table, const char *key, uint64_t hash, cdictionary_entry_t **p_entry, size_t *p_free)
+{
+    const size_t kMask = table->num_bucket - 1;
+    bool is_free_found = false;
+
+    for (size_t i = hash & kMask ; ; i = (i+1) & kMask){
+        cdictionary_entry_t *entry = atomic_load_explicit(&table->slot[i], memory_order_acquire);
+        if (NULL == entry){
+            if (p_free && !is_free_found) *p_free = i;
+            return -1;
+        }
+        if (DELETED == entry){
+            if (p_free && !is_free_found){
+                *p_free = i;
+                is_free_found = true;
+            }
+            continue;
+        }
+        if (hash == entry->hash && 0 == strcmp(entry->key, key)){
+            *p_entry = entry;
+            return (long)i;
+        }
+    }
+}
+
+/* return the value set at key, or NULL. must be called from within
+    a read section, the value may be used until the section is left */
+void*
+cdictionary_get(cdictionary_t *cdictionary, const char *key)
+{
+    uint64_t hash = hashtable_genhash(key, strlen(key));
+    cdictionary_shard_t *shard = _cdictionary_shard(cdictionary, hash);
+
+    cdictionary_table_t *table = atomic_load_explicit(&shard->table, memory_order_acquire);
+    cdictionary_entry_t *entry;
+    if (-1 == _cdictionary_find(table, key, hash, &entry, NULL)) return NULL;
+
+    return entry->value;
+}
+
+/* publish a copy of the shard's table, with twice as many slots
+    if it's getting full, or the same amount if deleted slots are
+    what fill it. readers of the previous table aren't disturbed */
+static bool
+_cdictionary_shard_grow(cdictionary_t *cdictionary, cdictionary_shard_t *shard)
+{
+    cdictionary_table_t *table = atomic_load_explicit(&shard->table, memory_order_relaxed);
+
+    size_t num_bucket = table->num_bucket;
+    if (shard->len + 1 > num_bucket / 2){
+        num_bucket *= 2;
+    }
+
+    cdictionary_table_t *new_table = _cdictionary_table_init(num_bucket);
+    const size_t kMask = num_bucket - 1;
+
+    for (size_t i=0; i < table->num_bucket; ++i){
+        cdictionary_entry_t *entry = atomic_load_explicit(&table->slot[i], memory_order_relaxed);
+        if (NULL == entry || DELETED == entry) continue;
+
+        size_t j = entry->hash & kMask;
+        while (NULL != atomic_load_explicit(&new_table->slot[j], memory_order_relaxed)){
+            j = (j+1) & kMask;
+        }
+        atomic_store_explicit(&new_table->slot[j], entry, memory_order_relaxed);
+    }
+    shard->num_deleted = 0;
+
+    atomic_store_explicit(&shard->table, new_table, memory_order_release);
+
+    return _cdictionary_retire(cdictionary, table, false);
+}
+
+/* unlike hashtable_set, if a value is already set it will be freed
+    once readers are done with it, and then assign a new one */
+void*
+cdictionary_set(cdictionary_t *cdictionary, const char *key, const void *value, void (*free_cb)(void*))
+{
+    const size_t kLen = strlen(key);
+    uint64_t hash = hashtable_genhash(key, kLen);
+    cdictionary_shard_t *shard = _cdictionary_shard(cdictionary, hash);
+
+    cdictionary_entry_t *new_entry = malloc(sizeof *new_entry);
+    assert(NULL != new_entry);
+
+    new_entry->key = strndup(key, kLen);
+    assert(NULL != new_entry->key);
+    new_entry->hash = hash;
+    new_entry->value = (void*)value;
+    new_entry->free_cb = free_cb;
+
+    bool should_reclaim = false;
+
+    pthread_mutex_lock(&shard->lock);
+
+    cdictionary_table_t *table = atomic_load_explicit(&shard->table, memory_order_relaxed);
+    cdictionary_entry_t *entry;
+    size_t i_free = 0;
+    long i = _cdictionary_find(table, key, hash, &entry, &i_free);
+    if (-1 != i){
+        atomic_store_explicit(&table->slot[i], new_entry, memory_order_release);
+
+        should_reclaim = _cdictionary_retire(cdictionary, entry, true);
+    }
+    else {
+        if (shard->len + shard->num_deleted + 1 > MAX_LOAD(table->num_bucket)){
+            should_reclaim = _cdictionary_shard_grow(cdictionary, shard);
+
+            table = atomic_load_explicit(&shard->table, memory_order_relaxed);
+            _cdictionary_find(table, key, hash, &entry, &i_free);
+        }
+        else if (DELETED == atomic_load_explicit(&table->slot[i_free], memory_order_relaxed)){
+            --shard->num_deleted;
+        }
+        atomic_store_explicit(&table->slot[i_free], new_entry, memory_order_release);
+
+        ++shard->len;
+        atomic_fetch_add_explicit(&cdictionary->len, 1, memory_order_relaxed);
+    }
+
+    pthread_mutex_unlock(&shard->lock);
+
+    if (should_reclaim){
+        _cdictionary_try_reclaim(cdictionary);
+    }
+
+    return (void*)value;
+}
+
+void
+cdictionary_remove(cdictionary_t *cdictionary, const char *key)
+{
+    uint64_t hash = hashtable_genhash(key, strlen(key));
+    cdictionary_shard_t *shard = _cdictionary_shard(cdictionary, hash);
+
+    bool should_reclaim = false;
+
+    pthread_mutex_lock(&shard->lock);
+
+    cdictionary_table_t *table = atomic_load_explicit(&shard->table, memory_order_relaxed);
+    cdictionary_entry_t *entry;
+    long i = _cdictionary_find(table, key, hash, &entry, NULL);
+    if (-1 != i){
+        atomic_store_explicit(&table->slot[i], DELETED, memory_order_release);
+
+        --shard->len;
+        ++shard->num_deleted;
+        atomic_fetch_sub_explicit(&cdictionary->len, 1, memory_order_relaxed);
+
+        should_reclaim = _cdictionary_retire(cdictionary, entry, true);
+    }
+
+    pthread_mutex_unlock(&shard->lock);
+
+    if (should_reclaim){
+        _cdictionary_try_reclaim(cdictionary);
+    }
+}
+
+size_t
+cdictionary_len(cdictionary_t *cdictionary){
+    return atomic_load_explicit(&cdictionary->len, memory_order_relaxed);
+}
@@ -0,0 +1,111 @@
+/*
+ * Copyright (c) 2020 Lucas Müller
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+#ifndef CDICTIONARY_H_
+#define CDICTIONARY_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdatomic.h>
+#include <pthread.h>
+
+/* amount of reader counters, readers are spread among them by thread */
+#define CDICTIONARY_STRIPES 16
+/* amount of retired entries and tables before they're reclaimed */
+#define CDICTIONARY_RETIRE_BATCH 64
+
+typedef struct cdictionary_entry_s {
+    char *key; //this entry key tag
+    uint64_t hash; //this entry key hash
+    void *value; //this entry value
+    void (*free_cb)(void*); //the destructor callback function for value, NULL if none
+} cdictionary_entry_t;
+
+/* linear probing table of entries, a slot is either empty (NULL),
+      deleted (a sentinel) or points to an entry. entries are never
+      modified once published, a new value is set by swapping the
+      slot for a new entry */
+typedef struct cdictionary_table_s {
+    size_t num_bucket; //capacity, a power of two
+    _Atomic(cdictionary_entry_t*) slot[]; //num_bucket of them
+} cdictionary_table_t;
+
+/* each shard is written under its own lock, while its table is read
+      without any. growing the table publishes a new one in its place */
+typedef struct cdictionary_shard_s {
+    pthread_mutex_t lock; //serializes writers
+    _Atomic(cdictionary_table_t*) table; //readers load it once per lookup
+    size_t len; //amount of entries (guarded by lock)
+    size_t num_deleted; //amount of deleted slots (guarded by lock)
+} cdictionary_shard_t;
+
+/* a memory block that is only freed once no reader can reach it */
+typedef struct cdictionary_retired_s {
+    void *ptr; //entry or table
+    bool is_entry; //entries also free their key and value
+    struct cdictionary_retired_s *next;
+} cdictionary_retired_t;
+
+/* a reader counter, kept apart from its neighbours' cache lines */
+typedef struct cdictionary_stripe_s {
+    _Alignas(64) atomic_size_t count[2]; //readers of each epoch parity
+} cdictionary_stripe_t;
+
+/* a dictionary_t that can be shared by threads. writers lock the
+      shard the key hashes to, readers never lock nor wait. memory
+      that was replaced or removed is reclaimed once every read
+      section that could see it has left (epoch based):
+   readers must look up from within cdictionary_enter() and
+      cdictionary_leave(), and may use the values found until they
+      leave. a write from within a read section leaves reclamation
+      to a later write */
+typedef struct cdictionary_s {
+    cdictionary_shard_t *shard; //num_shard of them
+    size_t num_shard; //a power of two
+    unsigned shard_shift; //the hash upper bits select a shard
+
+    atomic_size_t len; //amount of entries
+
+    atomic_uint epoch; //current epoch, its parity selects readers counters
+    cdictionary_stripe_t reader[CDICTIONARY_STRIPES];
+
+    pthread_mutex_t retire_lock; //guards retired list
+    cdictionary_retired_t *retired; //waiting for readers to leave
+    size_t num_retired;
+    pthread_mutex_t sync_lock; //serializes reclamations
+} cdictionary_t;
+
+cdictionary_t* cdictionary_init(size_t num_shard);
+void cdictionary_destroy(cdictionary_t *cdictionary);
+
+unsigned cdictionary_enter(cdictionary_t *cdictionary);
+void cdictionary_leave(cdictionary_t *cdictionary, unsigned token);
+
+void *cdictionary_get(cdictionary_t *cdictionary, const char *key);
+void *cdictionary_set(cdictionary_t *cdictionary, const char *key, const void *value, void (*free_cb)(void*));
+void cdictionary_remove(cdictionary_t *cdictionary, const char *key);
+size_t cdictionary_len(cdictionary_t *cdictionary);
+void cdictionary_reclaim(cdictionary_t *cdictionary);
+
+#endif
@@ -24,155 +24,554 @@
 #include <stdlib.h>
 #include <string.h>
 #include <assert.h>
+#include <time.h>
+#include <pthread.h>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
 
 #include "hashtable.h"
+#include "jscon-alloc.h"
 
-hashtable_t*
-hashtable_init()
+/* control byte states, a full slot holds its hash's lower 7 bits */
+#define CTRL_EMPTY      0x80
+#define CTRL_DELETED    0xFE
+
+#define HASH_TAG(hash) ((unsigned char)((hash) & 0x7F))
+#define HASH_POS(hash) ((size_t)((hash) >> 7))
+
+/* maximum load factor of 7/8, keeps empty slots around so that
+      lookups of missing keys terminate early */
+#define MAX_LOAD(num_bucket) ((num_bucket) - (num_bucket)/8)
+
+/* 64x64 -> 128 bits multiply, folded back to 64 bits */
+static inline uint64_t
+_hashtable_mum(uint64_t a, uint64_t b)
 {
-    hashtable_t *new_hashtable = calloc(1, sizeof *new_hashtable);
-    assert(NULL != new_hashtable);
+    uint64_t a_lo = (uint32_t)a, a_hi = a >> 32;
+    uint64_t b_lo = (uint32_t)b, b_hi = b >> 32;
 
-    return new_hashtable;
+    uint64_t lo_lo = a_lo * b_lo;
+    uint64_t hi_lo = a_hi * b_lo;
+    uint64_t lo_hi = a_lo * b_hi;
+    uint64_t hi_hi = a_hi * b_hi;
+
+    uint64_t cross = (lo_lo >> 32) + (uint32_t)hi_lo + lo_hi;
+    uint64_t hi = hi_hi + (hi_lo >> 32) + (cross >> 32);
+    uint64_t lo = (cross << 32) | (uint32_t)lo_lo;
+
+    return hi ^ lo;
 }
 
-void
-hashtable_destroy(hashtable_t *hashtable)
+static inline uint64_t
+_hashtable_read64(const char *p)
 {
-    for (size_t i=0; i < hashtable->num_bucket; ++i){
-        if (NULL == hashtable->bucket[i])
-            continue;
+    uint64_t v;
+    memcpy(&v, p, sizeof v);
+    return v;
+}
 
-        hashtable_entry_t *entry = hashtable->bucket[i];
-        hashtable_entry_t *entry_prev;
-        while (NULL != entry){
-            entry_prev = entry;
-            entry = entry->next;
+static inline uint64_t
+_hashtable_read32(const char *p)
+{
+    uint32_t v;
+    memcpy(&v, p, sizeof v);
+    return v;
+}
+
+static uint64_t hashtable_seed;
+static pthread_once_t hashtable_seed_once = PTHREAD_ONCE_INIT;
+
+/* pick a random seed, so that colliding keys can't be known
+      beforehand by whoever writes the json */
+static void
+_hashtable_seed_init()
+{
+    uint64_t seed = 0;
+
+    FILE *f_urandom = fopen("/dev/urandom", "rb");
+    if (NULL != f_urandom){
+        if (1 != fread(&seed, sizeof seed, 1, f_urandom))
+            seed = 0;
+        fclose(f_urandom);
+    }
+
+    if (0 == seed){ /* fallback to whatever varies between runs */
+        struct timespec ts;
+        clock_gettime(CLOCK_REALTIME, &ts);
+        seed = ((uint64_t)ts.tv_sec << 32) ^ (uint64_t)ts.tv_nsec
+                ^ (uint64_t)(uintptr_t)&seed ^ (uint64_t)clock();
+    }
 
-            free(entry_prev);
-            entry_prev = NULL;
+    hashtable_seed = _hashtable_mum(seed ^ 0xa0761d6478bd642full, 0xe7037ed1a0b428dbull);
+}
+
+/* seeded wyhash style hash, consumes 16 bytes per round */
+uint64_t
+hashtable_genhash(const char *key, size_t len)
+{
+    const uint64_t kSecret[4] = {
+        0xa0761d6478bd642full, 0xe7037ed1a0b428dbull,
+        0x8ebc6af09c88c6e3ull, 0x589965cc75374cc3ull
+    };
+
+    pthread_once(&hashtable_seed_once, &_hashtable_seed_init);
+
+    uint64_t seed = hashtable_seed ^ _hashtable_mum(hashtable_seed ^ kSecret[0], kSecret[1]);
+    uint64_t a, b;
+    if (len <= 16){
+        if (len >= 4){
+            a = (_hashtable_read32(key) << 32) | _hashtable_read32(key + ((len >> 3) << 2));
+            b = (_hashtable_read32(key + len - 4) << 32) | _hashtable_read32(key + len - 4 - ((len >> 3) << 2));
+        } else if (len > 0){
+            a = ((uint64_t)(unsigned char)key[0] << 16)
+                | ((uint64_t)(unsigned char)key[len >> 1] << 8)
+                | (unsigned char)key[len - 1];
+            b = 0;
+        } else {
+            a = b = 0;
         }
+    } else {
+        size_t i = len;
+        const char *p = key;
+        while (i > 16){
+            seed = _hashtable_mum(_hashtable_read64(p) ^ kSecret[1], _hashtable_read64(p + 8) ^ seed);
+            p += 16;
+            i -= 16;
+        }
+        a = _hashtable_read64(p + i - 16);
+        b = _hashtable_read64(p + i - 8);
     }
-    free(hashtable->bucket);
-    hashtable->bucket = NULL;
-    
-    free(hashtable);
-    hashtable = NULL;
+
+    return _hashtable_mum(kSecret[1] ^ len, _hashtable_mum(a ^ kSecret[1], b ^ seed));
 }
 
-static size_t
-_hashtable_genhash(const char *key, const size_t num_bucket)
+/* return a bitmask of the group's control bytes that are equal to c */
+static inline unsigned
+_hashtable_match(const unsigned char *group, unsigned char c)
+{
+#ifdef __SSE2__
+    __m128i ctrl = _mm_loadu_si128((const __m128i*)group);
+    return (unsigned)_mm_movemask_epi8(_mm_cmpeq_epi8(ctrl, _mm_set1_epi8((char)c)));
+#else
+    unsigned mask = 0;
+    for (unsigned i=0; i < HASHTABLE_GROUP; ++i){
+        mask |= (unsigned)(group[i] == c) << i;
+    }
+    return mask;
+#endif
+}
+
+/* bitmask of the group's empty or deleted control bytes */
+static inline unsigned
+_hashtable_match_free(const unsigned char *group)
 {
-    size_t slot = 0;
-    size_t key_len = strlen(key);
+#ifdef __SSE2__
+    /* both states have the high bit set, full slots don't */
+    return (unsigned)_mm_movemask_epi8(_mm_loadu_si128((const __m128i*)group));
+#else
+    unsigned mask = 0;
+    for (unsigned i=0; i < HASHTABLE_GROUP; ++i){
+        mask |= (unsigned)(group[i] >> 7) << i;
+    }
+    return mask;
+#endif
+}
 
-    /* @todo learn different implementations and improvements */
-    for (size_t i=0; i < key_len; ++i){
-        slot = slot * 37 + key[i];
+static inline unsigned
+_hashtable_lowest_bit(unsigned mask)
+{
+    unsigned i = 0;
+    while (!(mask & 1)){
+        mask >>= 1;
+        ++i;
     }
+    return i;
+}
 
-    slot %= num_bucket;
+/* tables smaller than a group are probed at once, the control bytes
+      past their capacity are masked out */
+static inline unsigned
+_hashtable_group_mask(const hashtable_t *hashtable)
+{
+    if (hashtable->num_bucket >= HASHTABLE_GROUP) return 0xFFFF;
 
-    return slot;
+    return (1u << hashtable->num_bucket) - 1;
 }
 
-static hashtable_entry_t*
-_hashtable_pair(const char *key, const void *value)
+/* small tables aren't mirrored, so they're always probed from
+      the start */
+static inline size_t
+_hashtable_probe_start(const hashtable_t *hashtable, uint64_t hash)
 {
-    hashtable_entry_t *new_entry = calloc(1, sizeof *new_entry);
-    assert(NULL != new_entry);
+    if (hashtable->num_bucket < HASHTABLE_GROUP) return 0;
 
-    new_entry->key = (char*)key;
-    new_entry->value = (void*)value;
+    return HASH_POS(hash) & (hashtable->num_bucket - 1);
+}
 
-    return new_entry;
+static inline void
+_hashtable_set_ctrl(hashtable_t *hashtable, size_t i, unsigned char c)
+{
+    hashtable->ctrl[i] = c;
+    if (i < HASHTABLE_GROUP - 1 && hashtable->num_bucket >= HASHTABLE_GROUP){
+        hashtable->ctrl[hashtable->num_bucket + i] = c; /* mirrored */
+    }
 }
 
-void
-hashtable_build(hashtable_t *hashtable, const size_t num_index)
+/* return the slot index of key, or -1 if missing */
+static long
+_hashtable_find(const hashtable_t *hashtable, const char *key, uint64_t hash)
 {
-    hashtable->num_bucket = num_index;
+    if (0 == hashtable->num_bucket) return -1;
+
+    const size_t kMask = hashtable->num_bucket - 1;
+    const unsigned kGroupMask = _hashtable_group_mask(hashtable);
+
+    size_t pos = _hashtable_probe_start(hashtable, hash);
+    for (size_t step = HASHTABLE_GROUP; ; step += HASHTABLE_GROUP){
+        const unsigned char *group = hashtable->ctrl + pos;
+
+        unsigned match = _hashtable_match(group, HASH_TAG(hash)) & kGroupMask;
+        while (match){
+            size_t i = (pos + _hashtable_lowest_bit(match)) & kMask;
+            /* full hashes tell most mismatches apart */
+            if (hash == hashtable->slot[i].hash && 0 == strcmp(hashtable->slot[i].key, key))
+                return (long)i;
 
-    hashtable->bucket = calloc(1, hashtable->num_bucket * sizeof *hashtable->bucket);
-    assert(NULL != hashtable->bucket);
+            match &= match - 1;
+        }
+
+        /* an empty slot means the key would have been placed there */
+        if ((_hashtable_match(group, CTRL_EMPTY) & kGroupMask) || kGroupMask != 0xFFFF)
+            return -1;
+
+        pos = (pos + step) & kMask;
+    }
+}
+
+/* return the first free slot index of hash's probe sequence, the
+      amount of groups probed is set at p_num_probe */
+static size_t
+_hashtable_find_free(const hashtable_t *hashtable, uint64_t hash, size_t *p_num_probe)
+{
+    const size_t kMask = hashtable->num_bucket - 1;
+    const unsigned kGroupMask = _hashtable_group_mask(hashtable);
+
+    size_t pos = _hashtable_probe_start(hashtable, hash);
+    for (size_t step = HASHTABLE_GROUP; ; step += HASHTABLE_GROUP){
+        unsigned match = _hashtable_match_free(hashtable->ctrl + pos) & kGroupMask;
+        if (match){
+            *p_num_probe = step / HASHTABLE_GROUP;
+            return (pos + _hashtable_lowest_bit(match)) & kMask;
+        }
+
+        pos = (pos + step) & kMask;
+    }
+}
+
+static int
+_hashtable_ordered_cmp(const void *a, const void *b)
+{
+    uint64_t hash_a = ((const hashtable_entry_t*)a)->hash;
+    uint64_t hash_b = ((const hashtable_entry_t*)b)->hash;
+
+    return (hash_a > hash_b) - (hash_a < hash_b);
 }
 
-hashtable_entry_t*
-_hashtable_get_entry(hashtable_t *hashtable, const char *key)
+/* binary search each sorted run, deleted entries have their key
+      set to NULL and are skipped */
+static long
+_hashtable_ordered_find(const hashtable_t *hashtable, const char *key, uint64_t hash)
 {
-    if (0 == hashtable->num_bucket) return NULL;
+    const size_t kTotal = hashtable->len + hashtable->num_deleted;
 
-    size_t slot = _hashtable_genhash(key, hashtable->num_bucket);
+    size_t offset = 0;
+    for (size_t run_len = (size_t)1 << (8*sizeof(size_t) - 1); run_len; run_len >>= 1){
+        if (!(kTotal & run_len)) continue;
 
-    hashtable_entry_t *entry = hashtable->bucket[slot];
-    while (NULL != entry){ /* try to find key and return it */
-        if (0 == strcmp(entry->key, key)){
-            return entry;
+        const hashtable_entry_t *run = hashtable->slot + offset;
+
+        size_t lo = 0, hi = run_len;
+        while (lo < hi){ /* lower bound */
+            size_t mid = lo + (hi - lo) / 2;
+            if (run[mid].hash < hash)
+                lo = mid + 1;
+            else
+                hi = mid;
+        }
+        for ( ; lo < run_len && hash == run[lo].hash; ++lo){
+            if (NULL != run[lo].key && 0 == strcmp(run[lo].key, key))
+                return (long)(offset + lo);
         }
-        entry = entry->next;
+
+        offset += run_len;
+    }
+    return -1;
+}
+
+/* drop deleted entries, leaving a single sorted run */
+static void
+_hashtable_ordered_compact(hashtable_t *hashtable)
+{
+    const size_t kTotal = hashtable->len + hashtable->num_deleted;
+
+    size_t len = 0;
+    for (size_t i=0; i < kTotal; ++i){
+        if (NULL == hashtable->slot[i].key) continue; /* deleted */
+
+        hashtable->slot[len++] = hashtable->slot[i];
     }
+    qsort(hashtable->slot, len, sizeof(hashtable_entry_t), &_hashtable_ordered_cmp);
+
+    hashtable->num_deleted = 0;
+}
+
+/* append entry, then merge the runs that add up with it */
+static void
+_hashtable_ordered_insert(hashtable_t *hashtable, const char *key, const void *value, uint64_t hash)
+{
+    if (hashtable->num_deleted > hashtable->len){
+        _hashtable_ordered_compact(hashtable);
+    }
+
+    const size_t kTotal = hashtable->len + hashtable->num_deleted;
+
+    if (kTotal == hashtable->num_bucket){
+        size_t num_bucket = 2 * hashtable->num_bucket;
+
+        hashtable->slot = Jscon_realloc(hashtable->slot,
+                            hashtable->num_bucket * sizeof(hashtable_entry_t),
+                            num_bucket * sizeof(hashtable_entry_t));
+        assert(NULL != hashtable->slot);
+        hashtable->num_bucket = num_bucket;
+    }
+
+    hashtable->slot[kTotal].key = (char*)key;
+    hashtable->slot[kTotal].value = (void*)value;
+    hashtable->slot[kTotal].hash = hash;
+    ++hashtable->len;
+
+    /* runs of 1, 2, 4 ... entries at the tail become a single run,
+        sized by the lowest bit set at the new total */
+    size_t run_len = (kTotal + 1) & ~kTotal;
+    if (run_len > 1){
+        qsort(hashtable->slot + (kTotal + 1 - run_len), run_len, sizeof(hashtable_entry_t), &_hashtable_ordered_cmp);
+    }
+}
+
+/* turn the table into a single sorted run, deleted slots are dropped */
+static void
+_hashtable_make_ordered(hashtable_t *hashtable)
+{
+    size_t len = 0;
+    for (size_t i=0; i < hashtable->num_bucket; ++i){
+        if (hashtable->ctrl[i] & 0x80) continue; /* empty or deleted */
+
+        hashtable->slot[len++] = hashtable->slot[i];
+    }
+    qsort(hashtable->slot, len, sizeof(hashtable_entry_t), &_hashtable_ordered_cmp);
+
+    /* control bytes are left unused at the end of the block */
+    hashtable->ctrl = NULL;
+    hashtable->len = len;
+    hashtable->num_deleted = 0;
+    hashtable->is_ordered = true;
+}
+
+/* allocate num_bucket slots (power of two) and their control bytes
+      at a single block */
+static void
+_hashtable_alloc(hashtable_t *hashtable, size_t num_bucket)
+{
+    size_t num_ctrl = num_bucket + HASHTABLE_GROUP;
+
+    hashtable->slot = Jscon_malloc(num_bucket * sizeof(hashtable_entry_t) + num_ctrl);
+    assert(NULL != hashtable->slot);
+
+    hashtable->ctrl = (unsigned char*)(hashtable->slot + num_bucket);
+    memset(hashtable->ctrl, CTRL_EMPTY, num_ctrl);
 
-    return NULL;
+    hashtable->num_bucket = num_bucket;
+    hashtable->len = 0;
+    hashtable->num_deleted = 0;
+    hashtable->is_ordered = false;
 }
 
+/* return the amount of groups probed */
+static size_t
+_hashtable_insert(hashtable_t *hashtable, const char *key, const void *value, uint64_t hash)
+{
+    size_t num_probe;
+    size_t i = _hashtable_find_free(hashtable, hash, &num_probe);
+    if (CTRL_DELETED == hashtable->ctrl[i]){
+        --hashtable->num_deleted;
+    }
+    _hashtable_set_ctrl(hashtable, i, HASH_TAG(hash));
+
+    hashtable->slot[i].key = (char*)key;
+    hashtable->slot[i].value = (void*)value;
+    hashtable->slot[i].hash = hash;
+    ++hashtable->len;
+
+    return num_probe;
+}
+
+/* smallest capacity that holds num_entry entries */
+static size_t
+_hashtable_capacity(size_t num_entry)
+{
+    size_t num_bucket = 4;
+    while (MAX_LOAD(num_bucket) < num_entry){
+        num_bucket *= 2;
+    }
+    return num_bucket;
+}
+
+/* move entries to a table of num_bucket slots, deleted slots
+      are dropped */
+static void
+_hashtable_resize(hashtable_t *hashtable, size_t num_bucket)
+{
+    hashtable_t old = *hashtable;
+
+    _hashtable_alloc(hashtable, num_bucket);
+
+    for (size_t i=0; i < old.num_bucket; ++i){
+        if (old.ctrl[i] & 0x80) continue; /* empty or deleted */
+
+        _hashtable_insert(hashtable, old.slot[i].key, old.slot[i].value, old.slot[i].hash);
+    }
+
+    Jscon_free(old.slot);
+}
+
+hashtable_t*
+hashtable_init()
+{
+    hashtable_t *new_hashtable = Jscon_calloc(1, sizeof *new_hashtable);
+    assert(NULL != new_hashtable);
+
+    return new_hashtable;
+}
+
+void
+hashtable_destroy(hashtable_t *hashtable)
+{
+    Jscon_free(hashtable->slot);
+    hashtable->slot = NULL;
+    hashtable->ctrl = NULL;
+    
+    Jscon_free(hashtable);
+    hashtable = NULL;
+}
+
+/* size the table for num_entry entries, it grows past that
+      automatically. any previous entries are discarded */
+void
+hashtable_build(hashtable_t *hashtable, const size_t num_entry)
+{
+    Jscon_free(hashtable->slot);
+
+    _hashtable_alloc(hashtable, _hashtable_capacity(num_entry));
+}
+
+/* grow the table so that num_entry entries fit without resizing,
+      entries are kept */
+void
+hashtable_reserve(hashtable_t *hashtable, const size_t num_entry)
+{
+    if (hashtable->is_ordered) return; /* grows by itself */
+
+    size_t num_bucket = _hashtable_capacity(num_entry);
+    if (num_bucket <= hashtable->num_bucket) return;
+
+    _hashtable_resize(hashtable, num_bucket);
+}
+
+/* hash is the key's hashtable_genhash(), if known beforehand */
 void*
-hashtable_get(hashtable_t *hashtable, const char *key)
+hashtable_get_h(hashtable_t *hashtable, const char *key, uint64_t hash)
 {
-    hashtable_entry_t *entry = _hashtable_get_entry(hashtable, key);
-    return (NULL != entry) ? entry->value : NULL;
+    long i = hashtable->is_ordered
+                ? _hashtable_ordered_find(hashtable, key, hash)
+                : _hashtable_find(hashtable, key, hash);
+    return (-1 != i) ? hashtable->slot[i].value : NULL;
+}
+
+void*
+hashtable_get(hashtable_t *hashtable, const char *key){
+    return hashtable_get_h(hashtable, key, hashtable_genhash(key, strlen(key)));
+}
+
+/* if key is already set its value is kept and returned */
+void*
+hashtable_set(hashtable_t *hashtable, const char *key, const void *value){
+    return hashtable_set_h(hashtable, key, hashtable_genhash(key, strlen(key)), value);
 }
 
 void*
-hashtable_set(hashtable_t *hashtable, const char *key, const void *value)
+hashtable_set_h(hashtable_t *hashtable, const char *key, uint64_t hash, const void *value)
 {
-    size_t slot = _hashtable_genhash(key, hashtable->num_bucket);
+    if (hashtable->is_ordered){
+        long i = _hashtable_ordered_find(hashtable, key, hash);
+        if (-1 != i) return hashtable->slot[i].value;
 
-    hashtable_entry_t *entry = hashtable->bucket[slot];
-    if (NULL == entry){
-        hashtable->bucket[slot] = _hashtable_pair(key, value);
-        return hashtable->bucket[slot]->value;
+        _hashtable_ordered_insert(hashtable, key, value, hash);
+        return (void*)value;
     }
 
-    hashtable_entry_t *entry_prev;
-    while (NULL != entry){
-        if (0 == strcmp(entry->key, key)){
-            return entry->value;
-        }
-        entry_prev = entry;
-        entry = entry->next;
+    long i = _hashtable_find(hashtable, key, hash);
+    if (-1 != i) return hashtable->slot[i].value;
+
+    if (hashtable->len + hashtable->num_deleted >= MAX_LOAD(hashtable->num_bucket)){
+        /* grow if mostly full, otherwise just clear deleted slots */
+        size_t num_bucket = hashtable->num_bucket;
+        if (0 == num_bucket)
+            num_bucket = _hashtable_capacity(1);
+        else if (hashtable->num_deleted <= hashtable->len)
+            num_bucket *= 2;
+
+        _hashtable_resize(hashtable, num_bucket);
     }
 
-    entry_prev->next = _hashtable_pair(key, value);
+    if (_hashtable_insert(hashtable, key, value, hash) > HASHTABLE_MAX_PROBE){
+        /* this shouldn't happen with seeded hashes, unless the keys
+            were crafted to collide */
+        _hashtable_make_ordered(hashtable);
+    }
 
     return (void*)value;
 }
 
 void
-hashtable_remove(hashtable_t *hashtable, const char *key)
-{
-    if (0 == hashtable->num_bucket) return;
+hashtable_remove(hashtable_t *hashtable, const char *key){
+    hashtable_remove_h(hashtable, key, hashtable_genhash(key, strlen(key)));
+}
 
-    size_t slot = _hashtable_genhash(key, hashtable->num_bucket);
+void
+hashtable_remove_h(hashtable_t *hashtable, const char *key, uint64_t hash)
+{
+    if (hashtable->is_ordered){
+        long i = _hashtable_ordered_find(hashtable, key, hash);
+        if (-1 == i) return;
+
+        /* keeps its place (and hash) in the run */
+        hashtable->slot[i].key = NULL;
+        hashtable->slot[i].value = NULL;
+        --hashtable->len;
+        ++hashtable->num_deleted;
+        return;
+    }
 
-    hashtable_entry_t *entry = hashtable->bucket[slot];
-    hashtable_entry_t *entry_prev = NULL;
-    while (NULL != entry){
-        if (0 == strcmp(entry->key, key)){
-            if (NULL != entry_prev){
-                entry_prev->next = entry->next; 
-            } else {
-                hashtable->bucket[slot] = entry->next; 
-            }
+    long i = _hashtable_find(hashtable, key, hash);
+    if (-1 == i) return;
 
-            entry->key = NULL;
+    _hashtable_set_ctrl(hashtable, i, CTRL_DELETED);
+    hashtable->slot[i].key = NULL;
+    hashtable->slot[i].value = NULL;
 
-            free(entry);
-            entry = NULL;
-            return;
-        }
-        entry_prev = entry;
-        entry = entry->next;
-    }
+    --hashtable->len;
+    ++hashtable->num_deleted;
 }
 
 dictionary_t*
@@ -184,34 +583,38 @@ dictionary_init()
     return new_dictionary;
 }
 
-/* destroys keys and values aswell */
-void
-dictionary_destroy(dictionary_t *dictionary)
+static void
+_dictionary_entry_destroy(dictionary_entry_t *entry)
 {
-    for (size_t i=0; i < dictionary->num_bucket; ++i){
-        if (NULL == dictionary->bucket[i])
-            continue;
-
-        dictionary_entry_t *entry = dictionary->bucket[i];
-        dictionary_entry_t *entry_prev;
-        while (NULL != entry){
-            entry_prev = entry;
-            entry = entry->next;
+    /* free value if its tagged for freeing */
+    if (entry->free_cb && NULL != entry->value){
+        (*entry->free_cb)(entry->value);
+    }
 
-            free(entry_prev->key);
-            entry_prev->key = NULL;
+    free(entry->key);
+    entry->key = NULL;
 
-            /* free value if its tagged for freeing */
-            if (entry_prev->free_cb && NULL != entry_prev->value){
-                (*entry_prev->free_cb)(entry_prev->value);
-            }
+    free(entry);
+}
 
-            free(entry_prev);
-            entry_prev = NULL;
+/* destroys keys and values aswell */
+void
+dictionary_destroy(dictionary_t *dictionary)
+{
+    hashtable_t *table = &dictionary->table;
+    for (size_t i=0; i < table->num_bucket; ++i){
+        if (table->is_ordered){
+            if (i == table->len + table->num_deleted) break;
+            if (NULL == table->slot[i].key) continue; /* deleted */
+        }
+        else if (table->ctrl[i] & 0x80){
+            continue; /* empty or deleted */
         }
+
+        _dictionary_entry_destroy(table->slot[i].value);
     }
-    free(dictionary->bucket);
-    dictionary->bucket = NULL;
+    Jscon_free(table->slot);
+    table->slot = NULL;
     
     free(dictionary);
     dictionary = NULL;
@@ -233,37 +636,32 @@ _dictionary_pair(const char *key, const void *value, void (*free_cb)(void*))
     return new_entry;
 }
 
+void*
+dictionary_get(dictionary_t *dictionary, const char *key)
+{
+    dictionary_entry_t *entry = hashtable_get(&dictionary->table, key);
+    return (NULL != entry) ? entry->value : NULL;
+}
+
 /* unlike hashtable_set, if a value is already set it will free it first and then assign a new one */
 void*
 dictionary_set(dictionary_t *dictionary, const char *key, const void *value, void (*free_cb)(void*))
 {
-    size_t slot = _hashtable_genhash(key, dictionary->num_bucket);
-
-    dictionary_entry_t *entry = dictionary->bucket[slot];
-    if (NULL == entry){
-        dictionary->bucket[slot] = _dictionary_pair(key, value, free_cb);
-        ++dictionary->len;
-
-        return dictionary->bucket[slot]->value;
-    }
-
-    dictionary_entry_t *entry_prev;
-    while (NULL != entry){
-        if (0 == strcmp(entry->key, key)){
-            if (entry->free_cb && NULL != entry->value){
-                (*entry->free_cb)(entry->value);
-            }
+    dictionary_entry_t *entry = hashtable_get(&dictionary->table, key);
+    if (NULL != entry){
+        if (entry->free_cb && NULL != entry->value){
+            (*entry->free_cb)(entry->value);
+        }
 
-            entry->value = (void*)value;
-            entry->free_cb = free_cb;
+        entry->value = (void*)value;
+        entry->free_cb = free_cb;
 
-            return entry->value;
-        }
-        entry_prev = entry;
-        entry = entry->next;
+        return entry->value;
     }
 
-    entry_prev->next = _dictionary_pair(key, value, free_cb);
+    entry = _dictionary_pair(key, value, free_cb);
+    /* the entry owns the key the table points to */
+    hashtable_set(&dictionary->table, entry->key, entry);
     ++dictionary->len;
 
     return (void*)value;
@@ -272,45 +670,19 @@ dictionary_set(dictionary_t *dictionary, const char *key, const void *value, voi
 void
 dictionary_remove(dictionary_t *dictionary, const char *key)
 {
-    if (0 == dictionary->num_bucket) return;
-
-    size_t slot = _hashtable_genhash(key, dictionary->num_bucket);
+    dictionary_entry_t *entry = hashtable_get(&dictionary->table, key);
+    if (NULL == entry) return;
 
-    dictionary_entry_t *entry = dictionary->bucket[slot];
-    dictionary_entry_t *entry_prev = NULL;
-    while (NULL != entry){
-        if (0 == strcmp(entry->key, key)){
-            if (NULL != entry_prev){
-                entry_prev->next = entry->next; 
-            } else {
-                dictionary->bucket[slot] = entry->next; 
-            }
+    hashtable_remove(&dictionary->table, key);
+    _dictionary_entry_destroy(entry);
 
-            free(entry->key);
-            entry->key = NULL;
-
-            /* free value if its tagged for freeing */
-            if (entry->free_cb && NULL != entry->value){
-                (*entry->free_cb)(entry->value);
-            }
-
-            free(entry);
-            entry = NULL;
-
-            --dictionary->len;
-
-            return;
-        }
-        entry_prev = entry;
-        entry = entry->next;
-    }
+    --dictionary->len;
 }
 
 void*
 dictionary_replace(dictionary_t *dictionary, const char *key, void *new_value)
 {
-    /* this works, because dictionary and hashtable structs are aligned */
-    dictionary_entry_t *entry = (dictionary_entry_t*)_hashtable_get_entry((hashtable_t*)dictionary, key);
+    dictionary_entry_t *entry = hashtable_get(&dictionary->table, key);
 
     if (entry->free_cb && NULL != entry->value){
         (*entry->free_cb)(entry->value);
@@ -23,45 +23,73 @@
 #ifndef HASHTABLE_H_
 #define HASHTABLE_H_
 
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+/* amount of control bytes probed at once */
+#define HASHTABLE_GROUP 16
+
 typedef struct hashtable_entry_s {
     char *key; //this entry key tag
     void *value; //this entry value
-    struct hashtable_entry_s *next; //next entry pointer for when keys don't match
+    uint64_t hash; //this entry key hash, so that keys aren't rehashed
 } hashtable_entry_t;
 
+/* a probe sequence longer than this (in groups) turns the table
+      into an ordered one */
+#define HASHTABLE_MAX_PROBE 8
+
+/* open addressing table, each slot has a control byte that is either
+      empty, deleted, or the 7 lower bits of its key's hash. a lookup
+      compares HASHTABLE_GROUP control bytes at a time, and only calls
+      strcmp for the slots whose tag matches.
+   keys are hashed with a per-process random seed, should an insertion
+      probe too far regardless (ie: flooding), the table falls back to
+      sorted runs of entries (one per bit set at len+num_deleted, from
+      the biggest to the smallest), with O(log^2 n) lookups */
 typedef struct hashtable_s {
-    hashtable_entry_t **bucket;
-    size_t num_bucket;
+    hashtable_entry_t *slot; //entries, num_bucket of them
+    unsigned char *ctrl; //control bytes, mirrors its first group at the end (NULL if ordered)
+    size_t num_bucket; //capacity, a power of two (0 if not built)
+    size_t len; //amount of entries
+    size_t num_deleted; //amount of deleted slots that aren't empty yet
+    bool is_ordered; //entries are kept sorted by hash, instead of hashed
 } hashtable_t;
 
+uint64_t hashtable_genhash(const char *key, size_t len);
+
 hashtable_t* hashtable_init();
 void hashtable_destroy(hashtable_t *hashtable);
-void hashtable_build(hashtable_t *hashtable, const size_t kNum_index);
+void hashtable_build(hashtable_t *hashtable, const size_t kNum_entry);
+void hashtable_reserve(hashtable_t *hashtable, const size_t kNum_entry);
 void *hashtable_get(hashtable_t *hashtable, const char *key);
+void *hashtable_get_h(hashtable_t *hashtable, const char *key, uint64_t hash);
 void *hashtable_set(hashtable_t *hashtable, const char *key, const void *value);
+void *hashtable_set_h(hashtable_t *hashtable, const char *key, uint64_t hash, const void *value);
 void hashtable_remove(hashtable_t *hashtable, const char *key);
+void hashtable_remove_h(hashtable_t *hashtable, const char *key, uint64_t hash);
 
 typedef struct dictionary_entry_s {
     char *key; //this entry key tag
     void *value; //this entry value
-    struct dictionary_entry_s *next; //next entry pointer for when keys don't match
     void (*free_cb)(void*); //the destructor callback function for value, NULL if none
 } dictionary_entry_t;
 
 /* basically a hashtable with some extra functionalities
       it will allocate the key and free it up for you, also
-      allows to pass a value that may be tagged for being freed */
+      allows to pass a value that may be tagged for being freed.
+      the hashtable maps keys to dictionary entries */
 typedef struct dictionary_s {
-    dictionary_entry_t **bucket;
-    size_t num_bucket;
+    hashtable_t table;
     size_t len;
 } dictionary_t;
 
 dictionary_t* dictionary_init();
 void dictionary_destroy(dictionary_t *dictionary);
 
-#define dictionary_build(dict, num_index) hashtable_build((hashtable_t*)dict, num_index)
-#define dictionary_get(dict, key) hashtable_get((hashtable_t*)dict, key)
+#define dictionary_build(dict, num_entry) hashtable_build(&(dict)->table, num_entry)
+void *dictionary_get(dictionary_t *dictionary, const char *key);
 void *dictionary_set(dictionary_t *dictionary, const char *key, const void *value, void (*free_cb)(void*));
 void dictionary_remove(dictionary_t *dictionary, const char *key);
 void *dictionary_replace(dictionary_t *dictionary, const char *key, void *new_value);
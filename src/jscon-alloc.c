@@ -0,0 +1,149 @@
+/*
+ * Copyright (c) 2020 Lucas Müller
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+
+#include <libjscon.h>
+
+#include "jscon-alloc.h"
+#include "debug.h"
+
+
+/* blocks are aligned as malloc() would */
+#define JSCON_ALLOC_ALIGN _Alignof(max_align_t)
+
+/* the active allocation context (NULL if heap), it belongs to the
+    thread currently parsing */
+static _Thread_local jscon_alloc_t *jscon_alloc;
+
+/* make alloc the active context (NULL for heap), and return the
+    previously active one so that it can be restored afterwards */
+jscon_alloc_t*
+Jscon_alloc_swap(jscon_alloc_t *alloc)
+{
+    jscon_alloc_t *prev = jscon_alloc;
+    jscon_alloc = alloc;
+
+    return prev;
+}
+
+/* abandon the parse, resuming from the active context's setjmp() */
+void
+Jscon_alloc_fail(int errcode)
+{
+    ASSERT_S(NULL != jscon_alloc, "No active allocation context");
+
+    jscon_alloc->errcode = errcode;
+    longjmp(jscon_alloc->jmp, 1);
+}
+
+static bool
+_jscon_alloc_owns(jscon_alloc_t *alloc, const void *ptr)
+{
+    if (NULL == alloc || NULL == alloc->mem) return false;
+
+    return ((const char*)ptr >= alloc->mem) && ((const char*)ptr < alloc->mem + alloc->mem_size);
+}
+
+void*
+Jscon_malloc(size_t size)
+{
+    jscon_alloc_t *alloc = jscon_alloc;
+    if (NULL == alloc) return malloc(size);
+
+    if (NULL == alloc->mem){
+        /* heap allocations are only accounted for, out of memory
+            is handled by the caller as usual */
+        alloc->mem_used += size;
+        return malloc(size);
+    }
+
+    /* bump allocation from the memory block */
+    size_t offset = (alloc->mem_used + JSCON_ALLOC_ALIGN - 1) & ~(JSCON_ALLOC_ALIGN - 1);
+    if (offset > alloc->mem_size || size > alloc->mem_size - offset)
+        Jscon_alloc_fail(JSCON_PARSE_ERR_MEM);
+
+    alloc->mem_used = offset + size;
+
+    return alloc->mem + offset;
+}
+
+void*
+Jscon_calloc(size_t num, size_t size)
+{
+    if (0 != size && num > SIZE_MAX / size) return NULL;
+
+    void *new_ptr = Jscon_malloc(num * size);
+    if (NULL != new_ptr){
+        memset(new_ptr, 0, num * size);
+    }
+    return new_ptr;
+}
+
+/* old_size is needed for moving memory block allocations */
+void*
+Jscon_realloc(void *ptr, size_t old_size, size_t new_size)
+{
+    jscon_alloc_t *alloc = jscon_alloc;
+    if (NULL == alloc || NULL == alloc->mem){
+        if (NULL != alloc) alloc->mem_used += new_size;
+        return realloc(ptr, new_size);
+    }
+
+    /* memory block allocations can't grow in place */
+    void *new_ptr = Jscon_malloc(new_size);
+    if (NULL != ptr){
+        memcpy(new_ptr, ptr, (old_size < new_size) ? old_size : new_size);
+    }
+    return new_ptr;
+}
+
+char*
+Jscon_strndup(const char *str, size_t n)
+{
+    size_t len = strnlen(str, n);
+
+    jscon_alloc_t *alloc = jscon_alloc;
+    if (NULL != alloc && 0 != alloc->max_string_len && len > alloc->max_string_len)
+        Jscon_alloc_fail(JSCON_PARSE_ERR_STRING);
+
+    char *new_str = Jscon_malloc(len + 1);
+    if (NULL == new_str) return NULL;
+
+    memcpy(new_str, str, len);
+    new_str[len] = '\0';
+
+    return new_str;
+}
+
+/* memory block allocations aren't freed individually */
+void
+Jscon_free(void *ptr)
+{
+    if (_jscon_alloc_owns(jscon_alloc, ptr)) return;
+
+    free(ptr);
+}
@@ -0,0 +1,62 @@
+/*
+ * Copyright (c) 2020 Lucas Müller
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+#ifndef JSCON_ALLOC_H_
+#define JSCON_ALLOC_H_
+
+#include <stddef.h>
+#include <stdbool.h>
+#include <setjmp.h>
+
+/* JSCON ALLOCATION CONTEXT
+ *  while jscon_parse_ex() runs with a memory block or resource limits,
+ *  every allocation for the tree being built goes through the Jscon_*
+ *  hooks below. if there's no active context, the hooks behave as
+ *  their stdlib counterparts:
+ *      mem: memory block to place allocations at (NULL for heap)
+ *      mem_size: the memory block size
+ *      mem_used: amount of bytes allocated so far
+ *      max_string_len: Jscon_strndup() length limit (0 for unlimited)
+ *      errcode: why the parse failed (check enum jscon_parse_errcode)
+ *      jmp: where to resume if the parse fails */
+typedef struct jscon_alloc_s {
+    char *mem;
+    size_t mem_size;
+    size_t mem_used;
+
+    size_t max_string_len;
+
+    int errcode;
+    jmp_buf jmp;
+} jscon_alloc_t;
+
+jscon_alloc_t* Jscon_alloc_swap(jscon_alloc_t *alloc);
+void Jscon_alloc_fail(int errcode);
+
+void* Jscon_malloc(size_t size);
+void* Jscon_calloc(size_t num, size_t size);
+void* Jscon_realloc(void *ptr, size_t old_size, size_t new_size);
+char* Jscon_strndup(const char *str, size_t n);
+void Jscon_free(void *ptr);
+
+#endif
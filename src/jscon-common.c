@@ -28,49 +28,338 @@
 
 #include <libjscon.h>
 #include "jscon-common.h"
+#include "jscon-alloc.h"
 
 #include "strscpy.h"
 #include "debug.h"
 
 
-/* reentrant hashtable linking function */
 void
-Jscon_composite_link_r(jscon_item_t *item, jscon_composite_t **p_last_accessed_comp)
+Jscon_composite_build(jscon_item_t *item)
 {
     ASSERT_S(IS_COMPOSITE(item), jscon_strerror(JSCON_EXT__NOT_COMPOSITE, item));
 
-    jscon_composite_t *last_accessed_comp = *p_last_accessed_comp;
-    if (NULL != last_accessed_comp){
-        last_accessed_comp->next = item->comp; /* item is not root */
-        item->comp->prev = last_accessed_comp;
+    Jscon_composite_compact(item);
+
+    hashtable_build(item->comp->hashtable, item->comp->num_branch); /* grows on demand */
+
+    for (size_t i=0; i < item->comp->num_branch; ++i){
+        Jscon_composite_set(item->comp->branch[i]->key, item->comp->branch[i]);
+    }
+}
+
+/* return the item's key hash, it is computed at the first call if
+    it wasn't cached when the key was decoded */
+uint64_t
+Jscon_key_hash(jscon_item_t *item)
+{
+    if (0 == item->key_hash){
+        item->key_len = strlen(item->key);
+        item->key_hash = hashtable_genhash(item->key, item->key_len);
     }
+    return item->key_hash;
+}
 
-    last_accessed_comp = item->comp;
+/* the perfect hash block layout is:
+ *  [0]: amount of buckets (num_disp)
+ *  [1]: amount of slots (num_slot, one per distinct key)
+ *  [2, 2+2*num_disp): displacement (seed, offset) of each bucket
+ *  [2+2*num_disp, 2+2*num_disp+num_slot): branch index of each slot */
+#define PERFECT_NUM_DISP(perfect) ((perfect)[0])
+#define PERFECT_NUM_SLOT(perfect) ((perfect)[1])
+#define PERFECT_DISP(perfect) ((perfect) + 2)
+#define PERFECT_SLOT(perfect) ((perfect) + 2 + 2*PERFECT_NUM_DISP(perfect))
+#define PERFECT_SIZE(num_disp, num_slot) ((2 + 2*(size_t)(num_disp) + (num_slot)) * sizeof(uint32_t))
 
-    *p_last_accessed_comp = last_accessed_comp;
+/* map x to [0, n) without a division */
+static inline uint32_t
+_jscon_fastrange(uint32_t x, uint32_t n){
+    return (uint32_t)(((uint64_t)x * n) >> 32);
 }
 
-void
-Jscon_composite_build(jscon_item_t *item)
+/* the bucket a key hash belongs to */
+static inline uint32_t
+_jscon_perfect_bucket(uint64_t hash, uint32_t num_disp){
+    return _jscon_fastrange((uint32_t)(hash >> 32), num_disp);
+}
+
+/* the slot a key hash is placed at before its offset, a different
+    seed scatters the keys of a bucket differently */
+static inline uint32_t
+_jscon_perfect_base(uint64_t hash, uint32_t seed, uint32_t num_slot)
 {
-    ASSERT_S(IS_COMPOSITE(item), jscon_strerror(JSCON_EXT__NOT_COMPOSITE, item));
+    uint64_t x = hash ^ (seed * 0x9e3779b97f4a7c15ull);
+    x ^= x >> 33;
+    x *= 0xff51afd7ed558ccdull;
+    x ^= x >> 33;
+    return _jscon_fastrange((uint32_t)x, num_slot);
+}
+
+/* the slot a key hash is displaced to */
+static inline uint32_t
+_jscon_perfect_slot(uint64_t hash, const uint32_t disp[2], uint32_t num_slot)
+{
+    uint32_t slot = _jscon_perfect_base(hash, disp[0], num_slot) + disp[1];
+    return (slot >= num_slot) ? slot - num_slot : slot;
+}
 
-    hashtable_build(item->comp->hashtable, 2 + (1.3 * item->comp->num_branch)); /* 30% size increase to account for future expansions, and a default bucket size of 2 */
+/* a single probe, and a single key comparison */
+static jscon_item_t*
+_jscon_perfect_get(jscon_composite_t *comp, const char *key, uint64_t hash, size_t *p_index)
+{
+    const uint32_t *perfect = comp->perfect;
+    if (0 == PERFECT_NUM_SLOT(perfect)) return NULL;
 
-    item->comp->p_item = item;
+    const uint32_t *disp = PERFECT_DISP(perfect) + 2*_jscon_perfect_bucket(hash, PERFECT_NUM_DISP(perfect));
+    uint32_t index = PERFECT_SLOT(perfect)[_jscon_perfect_slot(hash, disp, PERFECT_NUM_SLOT(perfect))];
 
-    for (size_t i=0; i < item->comp->num_branch; ++i){
-        Jscon_composite_set(item->comp->branch[i]->key, item->comp->branch[i]);
+    jscon_item_t *branch = comp->branch[index];
+    if (!STREQ(branch->key, key)) return NULL;
+
+    *p_index = index;
+    return branch;
+}
+
+struct _jscon_perfect_key_s {
+    uint32_t bucket;
+    uint32_t index; /* branch index */
+};
+
+static int
+_jscon_perfect_key_cmp(const void *a, const void *b)
+{
+    const struct _jscon_perfect_key_s *key_a = a, *key_b = b;
+    if (key_a->bucket != key_b->bucket)
+        return (key_a->bucket > key_b->bucket) - (key_a->bucket < key_b->bucket);
+    return (key_a->index > key_b->index) - (key_a->index < key_b->index);
+}
+
+struct _jscon_perfect_bucket_s {
+    uint32_t start; /* first key of the bucket at the sorted keys */
+    uint32_t len;
+};
+
+static int
+_jscon_perfect_bucket_cmp(const void *a, const void *b)
+{
+    const struct _jscon_perfect_bucket_s *bucket_a = a, *bucket_b = b;
+    /* biggest buckets are placed first, while there's room */
+    if (bucket_a->len != bucket_b->len)
+        return (bucket_a->len < bucket_b->len) - (bucket_a->len > bucket_b->len);
+    return (bucket_a->start > bucket_b->start) - (bucket_a->start < bucket_b->start);
+}
+
+/* amount of seeds tried per bucket, before giving up */
+#define PERFECT_MAX_SEED (1u << 16)
+
+/* place a bucket's keys at the slots disp sends them to, return
+    false (with nothing placed) if any of them is taken */
+static bool
+_jscon_perfect_place(jscon_composite_t *comp, uint32_t *perfect, bool is_taken[], const struct _jscon_perfect_key_s bucket_keys[], uint32_t len, const uint32_t disp[2])
+{
+    const uint32_t kNum_slot = PERFECT_NUM_SLOT(perfect);
+
+    uint32_t j = 0;
+    for ( ; j < len; ++j){
+        uint64_t hash = Jscon_key_hash(comp->branch[bucket_keys[j].index]);
+        uint32_t slot = _jscon_perfect_slot(hash, disp, kNum_slot);
+        if (is_taken[slot]) break;
+
+        is_taken[slot] = true;
+        PERFECT_SLOT(perfect)[slot] = bucket_keys[j].index;
+    }
+    if (j == len) return true;
+
+    /* undo this displacement's placements */
+    while (j--){
+        uint64_t hash = Jscon_key_hash(comp->branch[bucket_keys[j].index]);
+        is_taken[_jscon_perfect_slot(hash, disp, kNum_slot)] = false;
+    }
+    return false;
+}
+
+/* replace the composite's hashtable with a minimal perfect hash of
+    its keys (hash and displace), placed right after its branches.
+    keys are split into buckets, then each bucket (biggest first)
+    looks for a seed that sends all of its keys to free slots.
+    single key buckets come last, and are offset straight into
+    whichever slots are left. return false if that couldn't be done,
+    in which case the hashtable is kept. the composite must not be
+    modified afterwards */
+bool
+Jscon_composite_freeze(jscon_item_t *item)
+{
+    jscon_composite_t *comp = item->comp;
+    atomic_store_explicit(&comp->refcount, 1, memory_order_relaxed);
+
+    /* its source is frozen already, or its branches weren't modified
+        since they were cloned from it */
+    if (NULL != comp->source || NULL != comp->perfect) return true;
+
+    Jscon_composite_unshare(item);
+    Jscon_composite_expand(item);
+    Jscon_composite_compact(item);
+
+    /* keys repeated at an object are unreachable past the first one */
+    size_t num_slot = 0;
+    for (size_t i=0; i < comp->num_branch; ++i){
+        if (Jscon_composite_get(comp->branch[i]->key, item) == comp->branch[i])
+            ++num_slot;
+    }
+    ASSERT_S(num_slot < UINT32_MAX, "Too many branches");
+
+    const uint32_t kNum_disp = (uint32_t)(num_slot / 4 + 1);
+
+    struct _jscon_perfect_key_s *keys = malloc((num_slot + 1) * sizeof *keys);
+    struct _jscon_perfect_bucket_s *buckets = calloc(kNum_disp, sizeof *buckets);
+    uint32_t *perfect = calloc(1, PERFECT_SIZE(kNum_disp, num_slot));
+    bool *is_taken = calloc(num_slot + 1, sizeof(bool));
+    ASSERT_S(keys && buckets && perfect && is_taken, jscon_strerror(JSCON_EXT__OUT_MEM, perfect));
+
+    PERFECT_NUM_DISP(perfect) = kNum_disp;
+    PERFECT_NUM_SLOT(perfect) = (uint32_t)num_slot;
+
+    size_t num_key = 0;
+    for (size_t i=0; i < comp->num_branch; ++i){
+        jscon_item_t *branch = comp->branch[i];
+        if (Jscon_composite_get(branch->key, item) != branch) continue;
+
+        keys[num_key].bucket = _jscon_perfect_bucket(Jscon_key_hash(branch), kNum_disp);
+        keys[num_key].index = (uint32_t)i;
+        ++num_key;
+    }
+    qsort(keys, num_key, sizeof *keys, &_jscon_perfect_key_cmp);
+
+    for (uint32_t i=0; i < num_key; ++i){
+        struct _jscon_perfect_bucket_s *bucket = &buckets[keys[i].bucket];
+        if (0 == bucket->len) bucket->start = i;
+        ++bucket->len;
     }
+    qsort(buckets, kNum_disp, sizeof *buckets, &_jscon_perfect_bucket_cmp);
+
+    bool is_frozen = true;
+    uint32_t free_slot = 0; /* lowest slot that might be free */
+    for (uint32_t i=0; i < kNum_disp && 0 != buckets[i].len; ++i){
+        const struct _jscon_perfect_key_s *bucket_keys = keys + buckets[i].start;
+        const uint32_t kLen = buckets[i].len;
+        uint32_t *disp = PERFECT_DISP(perfect) + 2*bucket_keys[0].bucket;
+
+        if (1 == kLen){
+            while (is_taken[free_slot])
+                ++free_slot;
+
+            uint32_t base = _jscon_perfect_base(Jscon_key_hash(comp->branch[bucket_keys[0].index]), 0, (uint32_t)num_slot);
+            disp[0] = 0;
+            disp[1] = (free_slot >= base) ? free_slot - base : free_slot + (uint32_t)num_slot - base;
+
+            is_taken[free_slot] = true;
+            PERFECT_SLOT(perfect)[free_slot] = bucket_keys[0].index;
+            continue;
+        }
+
+        /* each seed is tried as is, and shifted so that the bucket's
+            first key lands on the lowest free slot. the latter keeps
+            the last buckets placeable once few slots are left */
+        const uint64_t kHash = Jscon_key_hash(comp->branch[bucket_keys[0].index]);
+        for (disp[0]=0; disp[0] < PERFECT_MAX_SEED; ++disp[0]){
+            disp[1] = 0;
+            if (_jscon_perfect_place(comp, perfect, is_taken, bucket_keys, kLen, disp))
+                break;
+
+            while (is_taken[free_slot])
+                ++free_slot;
+
+            uint32_t base = _jscon_perfect_base(kHash, disp[0], (uint32_t)num_slot);
+            disp[1] = (free_slot >= base) ? free_slot - base : free_slot + (uint32_t)num_slot - base;
+            if (_jscon_perfect_place(comp, perfect, is_taken, bucket_keys, kLen, disp))
+                break;
+        }
+        if (PERFECT_MAX_SEED == disp[0]){ /* ie: keys with equal hashes */
+            is_frozen = false;
+            break;
+        }
+    }
+
+    free(keys);
+    free(buckets);
+    free(is_taken);
+
+    if (!is_frozen){
+        free(perfect);
+        return false;
+    }
+
+    /* place it next to the branches, for locality */
+    const size_t kBranch_size = comp->num_branch * sizeof(jscon_item_t*);
+    const size_t kPerfect_size = PERFECT_SIZE(kNum_disp, num_slot);
+
+    jscon_item_t **branch = realloc(comp->branch, kBranch_size + kPerfect_size);
+    ASSERT_S(NULL != branch, jscon_strerror(JSCON_EXT__OUT_MEM, branch));
+    memcpy((char*)branch + kBranch_size, perfect, kPerfect_size);
+    free(perfect);
+
+    comp->branch = branch;
+    comp->max_branch = comp->num_branch;
+    comp->perfect = (uint32_t*)((char*)branch + kBranch_size);
+
+    hashtable_destroy(comp->hashtable);
+    comp->hashtable = NULL;
+
+    return true;
 }
 
 jscon_item_t*
-Jscon_composite_get(const char *key, jscon_item_t *item)
+Jscon_composite_get(const char *key, jscon_item_t *item){
+    return Jscon_composite_get_h(key, hashtable_genhash(key, strlen(key)), item, NULL);
+}
+
+/* same as Jscon_composite_get(), with key's hash precomputed. if
+    p_index is given, it's set to the branch slot found */
+jscon_item_t*
+Jscon_composite_get_h(const char *key, uint64_t hash, jscon_item_t *item, size_t *p_index)
 {
     if (!IS_COMPOSITE(item)) return NULL;
 
+    Jscon_composite_expand(item);
+    if (NULL != item->comp->source){
+        return Jscon_composite_get_h(key, hash, item->comp->source, p_index);
+    }
+
     jscon_composite_t *comp = item->comp;
-    return hashtable_get(comp->hashtable, key);
+
+    size_t index = comp->num_branch;
+    jscon_item_t *branch;
+    if (NULL != comp->perfect){
+        branch = _jscon_perfect_get(comp, key, hash, &index);
+    }
+    else if (NULL != comp->shape){
+        index = (size_t)hashtable_get_h(comp->shape->hashtable, key, hash);
+        branch = (0 != index--) ? comp->branch[index] : NULL;
+    }
+    else {
+        branch = hashtable_get_h(comp->hashtable, key, hash);
+        if (NULL != branch) index = branch->index;
+    }
+
+    if (NULL != p_index){
+        *p_index = index;
+    }
+    return branch;
+}
+
+/* whether any of the composite's keys is repeated, in which case
+    only the first of its branches is reachable by that key */
+bool
+Jscon_composite_has_repeats(jscon_item_t *item)
+{
+    jscon_composite_t *comp = item->comp;
+    if (NULL != comp->perfect){
+        return PERFECT_NUM_SLOT(comp->perfect) < comp->num_branch;
+    }
+    if (NULL != comp->shape){
+        return comp->shape->hashtable->len < comp->shape->num_key;
+    }
+    return comp->hashtable->len < comp->num_branch - comp->num_deleted;
 }
 
 jscon_item_t*
@@ -79,14 +368,316 @@ Jscon_composite_set(const char *key, jscon_item_t *item)
     ASSERT_S(!IS_ROOT(item), "Can't add to parent hashtable if Item is root");
 
     jscon_composite_t *parent_comp = item->parent->comp;
+    if (key == item->key) /* reuse cached hash */
+        return hashtable_set_h(parent_comp->hashtable, key, Jscon_key_hash(item), item);
+
     return hashtable_set(parent_comp->hashtable, key, item);
 }
 
+/* grow the composite's branches vector to hold max_branch branches,
+    return false if out of memory */
+bool
+Jscon_composite_reserve(jscon_item_t *item, size_t max_branch)
+{
+    if (max_branch <= item->comp->max_branch) return true;
+
+    jscon_item_t **tmp = realloc(item->comp->branch, max_branch * sizeof(jscon_item_t*));
+    if (NULL == tmp) return false;
+
+    item->comp->branch = tmp;
+    item->comp->max_branch = max_branch;
+
+    return true;
+}
+
 /* remake hashtable on functions that deal with increasing branches */
 void
 Jscon_composite_remake(jscon_item_t *item)
 {
+    if (NULL != item->comp->shape || NULL != item->comp->perfect){
+        Jscon_composite_unshare(item); /* builds its own hashtable */
+        return;
+    }
+
+    hashtable_destroy(item->comp->hashtable);
+
+    item->comp->hashtable = hashtable_init();
+    ASSERT_S(NULL != item->comp->hashtable, jscon_strerror(JSCON_EXT__OUT_MEM, item->comp->hashtable));
+
+    Jscon_composite_build(item);
+}
+
+/* create a shape out of the object's keys, the keys ownership is
+    moved to the shape and the object's hashtable is discarded */
+static jscon_shape_t*
+_jscon_shape_init(jscon_item_t *item)
+{
+    jscon_shape_t *new_shape = calloc(1, sizeof *new_shape);
+    ASSERT_S(NULL != new_shape, jscon_strerror(JSCON_EXT__OUT_MEM, new_shape));
+
+    new_shape->num_key = item->comp->num_branch;
+    new_shape->key = malloc(new_shape->num_key * sizeof(char*));
+    ASSERT_S(NULL != new_shape->key, jscon_strerror(JSCON_EXT__OUT_MEM, new_shape->key));
+
+    new_shape->hashtable = hashtable_init();
+    ASSERT_S(NULL != new_shape->hashtable, jscon_strerror(JSCON_EXT__OUT_MEM, new_shape->hashtable));
+    hashtable_build(new_shape->hashtable, new_shape->num_key);
+
+    for (size_t i=0; i < new_shape->num_key; ++i){
+        jscon_item_t *branch = item->comp->branch[i];
+
+        new_shape->key[i] = branch->key;
+        hashtable_set_h(new_shape->hashtable, new_shape->key[i], Jscon_key_hash(branch), (void*)(i+1));
+        branch->flags |= JSCON_ITEM_SHARED_KEY;
+    }
+
+    hashtable_destroy(item->comp->hashtable);
+    item->comp->hashtable = NULL;
+
+    item->comp->shape = new_shape;
+    new_shape->refcount = 1;
+
+    return new_shape;
+}
+
+/* check if object keys match the given key sequence, in order */
+static bool
+_jscon_shape_match(jscon_item_t *item, char **key, size_t num_key)
+{
+    if (item->comp->num_branch != num_key) return false;
+
+    for (size_t i=0; i < num_key; ++i){
+        if (!STREQ(item->comp->branch[i]->key, key[i]))
+            return false;
+    }
+    return true;
+}
+
+/* wrap a parsed object by sharing its sibling's shape, if both of
+    them have the same key sequence. return false if they differ, in
+    which case the object should be built normally */
+bool
+Jscon_composite_share(jscon_item_t *item, jscon_item_t *sibling)
+{
+    ASSERT_S(JSCON_OBJECT == item->type, jscon_strerror(JSCON_EXT__NOT_COMPOSITE, item));
+
+    if (NULL == sibling || JSCON_OBJECT != sibling->type) return false;
+    if (0 == item->comp->num_branch) return false;
+
+    jscon_shape_t *shape = sibling->comp->shape;
+    if (NULL != shape){
+        if (!_jscon_shape_match(item, shape->key, shape->num_key))
+            return false;
+    } else {
+        /* sibling should have its own keys, check if they match,
+            and turn them into a shape that can be shared */
+        if (item->comp->num_branch != sibling->comp->num_branch)
+            return false;
+        for (size_t i=0; i < item->comp->num_branch; ++i){
+            if (!STREQ(item->comp->branch[i]->key, sibling->comp->branch[i]->key))
+                return false;
+        }
+        shape = _jscon_shape_init(sibling);
+    }
+
+    /* object's keys are duplicates of the shape's, replace them */
+    for (size_t i=0; i < item->comp->num_branch; ++i){
+        jscon_item_t *branch = item->comp->branch[i];
+
+        free(branch->key);
+        branch->key = shape->key[i];
+        branch->flags |= JSCON_ITEM_SHARED_KEY;
+    }
+
     hashtable_destroy(item->comp->hashtable);
+    item->comp->hashtable = NULL;
+
+    item->comp->shape = shape;
+    ++shape->refcount;
+
+    return true;
+}
+
+/* give the object its own keys and hashtable back, should be done
+    before any modification to its branches. a perfect hash copied
+    from a shared clone's source is dropped for a hashtable as well */
+void
+Jscon_composite_unshare(jscon_item_t *item)
+{
+    if (NULL != item->comp->perfect){
+        item->comp->perfect = NULL; /* lives in the branches block */
+
+        item->comp->hashtable = hashtable_init();
+        ASSERT_S(NULL != item->comp->hashtable, jscon_strerror(JSCON_EXT__OUT_MEM, item->comp->hashtable));
+
+        Jscon_composite_build(item);
+        return;
+    }
+
+    jscon_shape_t *shape = item->comp->shape;
+    if (NULL == shape) return;
+
+    for (size_t i=0; i < item->comp->num_branch; ++i){
+        jscon_item_t *branch = item->comp->branch[i];
+
+        branch->key = strdup(branch->key);
+        ASSERT_S(NULL != branch->key, jscon_strerror(JSCON_EXT__OUT_MEM, branch->key));
+        branch->flags &= ~JSCON_ITEM_SHARED_KEY;
+    }
+
+    item->comp->shape = NULL;
+    Jscon_shape_release(shape);
+
+    item->comp->hashtable = hashtable_init();
+    ASSERT_S(NULL != item->comp->hashtable, jscon_strerror(JSCON_EXT__OUT_MEM, item->comp->hashtable));
+
+    Jscon_composite_build(item);
+}
+
+/* decrement shape references, and free it if there are none left */
+void
+Jscon_shape_release(jscon_shape_t *shape)
+{
+    if (0 != --shape->refcount) return;
+
+    for (size_t i=0; i < shape->num_key; ++i){
+        free(shape->key[i]);
+    }
+    free(shape->key);
+
+    hashtable_destroy(shape->hashtable);
+
+    free(shape);
+}
+
+/* squeeze out the slots left by dettached branches, and update the
+    remaining branches positions. should be done before any access
+    that relies on branches positions, dettaching is O(1) while
+    compacting is O(n) for any amount of branches dettached since */
+void
+Jscon_composite_compact(jscon_item_t *item)
+{
+    jscon_composite_t *comp = item->comp;
+    if (0 == comp->num_deleted) return;
+
+    size_t num_branch = 0;
+    for (size_t i=0; i < comp->num_branch; ++i){
+        if (NULL == comp->branch[i]) continue;
+
+        comp->branch[num_branch] = comp->branch[i];
+        comp->branch[num_branch]->index = num_branch;
+        ++num_branch;
+    }
+    comp->num_branch = num_branch;
+    comp->num_deleted = 0;
+}
+
+/* clone the source's branches, one level at a time. nested composites
+    are cloned along with their own source, so the reference to this
+    one can be dropped afterwards */
+static void
+_jscon_composite_materialize(jscon_item_t *item)
+{
+    jscon_item_t *source = item->comp->source;
+    jscon_composite_t *source_comp = source->comp;
+    item->comp->source = NULL;
+
+    /* branches are cloned in the same order, so the source's perfect
+        hash (if any) is copied over rather than hashing every key
+        again, until the branches are modified (check
+        Jscon_composite_unshare()) */
+    const size_t kBranch_size = (1+source_comp->num_branch) * sizeof(jscon_item_t*);
+    const size_t kPerfect_size = (NULL != source_comp->perfect)
+        ? PERFECT_SIZE(PERFECT_NUM_DISP(source_comp->perfect), PERFECT_NUM_SLOT(source_comp->perfect))
+        : 0;
+
+    item->comp->branch = malloc(kBranch_size + kPerfect_size);
+    ASSERT_S(NULL != item->comp->branch, jscon_strerror(JSCON_EXT__OUT_MEM, item->comp->branch));
+    item->comp->max_branch = 1+source_comp->num_branch;
+
+    for (size_t i=0; i < source_comp->num_branch; ++i){
+        jscon_item_t *branch = source_comp->branch[i];
+
+        jscon_item_t *new_branch = Jscon_item_clone(branch, true);
+        new_branch->key = strdup(branch->key);
+        ASSERT_S(NULL != new_branch->key, jscon_strerror(JSCON_EXT__OUT_MEM, new_branch->key));
+        new_branch->key_len = branch->key_len;
+        new_branch->key_hash = branch->key_hash;
+        new_branch->parent = item;
+        new_branch->index = i;
+
+        item->comp->branch[i] = new_branch;
+    }
+    item->comp->num_branch = source_comp->num_branch;
+
+    if (0 != kPerfect_size){
+        item->comp->perfect = (uint32_t*)((char*)item->comp->branch + kBranch_size);
+        memcpy(item->comp->perfect, source_comp->perfect, kPerfect_size);
+    }
+    else {
+        item->comp->hashtable = hashtable_init();
+        ASSERT_S(NULL != item->comp->hashtable, jscon_strerror(JSCON_EXT__OUT_MEM, item->comp->hashtable));
+
+        Jscon_composite_build(item);
+    }
+
+    Jscon_composite_release(jscon_get_root(source));
+}
+
+/* turn a packed array or a shared clone into regular branches,
+    should be done before any access to the composite's branches.
+    frozen shared clones are left as is, and should be read from
+    their source */
+void
+Jscon_composite_expand(jscon_item_t *item)
+{
+    if (NULL != item->comp->source){
+        if (!IS_FROZEN(item)){
+            _jscon_composite_materialize(item);
+        }
+        return;
+    }
+    if (!IS_PACKED(item)) return;
+
+    jscon_packed_t *packed = item->comp->packed;
+
+    item->comp->branch = malloc((1+packed->len) * sizeof(jscon_item_t*));
+    ASSERT_S(NULL != item->comp->branch, jscon_strerror(JSCON_EXT__OUT_MEM, item->comp->branch));
+    item->comp->max_branch = 1+packed->len;
+
+    for (size_t i=0; i < packed->len; ++i){
+        jscon_item_t *new_branch = calloc(1, sizeof *new_branch);
+        ASSERT_S(NULL != new_branch, jscon_strerror(JSCON_EXT__OUT_MEM, new_branch));
+
+        char numkey[MAX_INTEGER_DIG+1];
+        snprintf(numkey, sizeof(numkey), "%zu", i);
+
+        new_branch->key = strdup(numkey);
+        ASSERT_S(NULL != new_branch->key, jscon_strerror(JSCON_EXT__OUT_MEM, new_branch->key));
+
+        new_branch->type = packed->type;
+        switch (packed->type){
+        case JSCON_INTEGER:
+            new_branch->i_number = packed->i_number[i];
+            break;
+        case JSCON_DOUBLE:
+            new_branch->d_number = packed->d_number[i];
+            break;
+        case JSCON_BOOLEAN:
+            new_branch->boolean = packed->boolean[i];
+            break;
+        default:
+            ERROR("Unknown packed type found\n\tCode: %d", packed->type);
+        }
+        new_branch->parent = item;
+        new_branch->index = i;
+
+        item->comp->branch[i] = new_branch;
+    }
+    item->comp->num_branch = packed->len;
+
+    item->comp->packed = NULL;
+    Jscon_packed_destroy(packed);
 
     item->comp->hashtable = hashtable_init();
     ASSERT_S(NULL != item->comp->hashtable, jscon_strerror(JSCON_EXT__OUT_MEM, item->comp->hashtable));
@@ -94,24 +685,176 @@ Jscon_composite_remake(jscon_item_t *item)
     Jscon_composite_build(item);
 }
 
+void
+Jscon_packed_destroy(jscon_packed_t *packed)
+{
+    free(packed->i_number); /* any member will do */
+    free(packed);
+}
+
+static jscon_packed_t*
+_jscon_packed_clone(jscon_packed_t *packed)
+{
+    jscon_packed_t *new_packed = malloc(sizeof *new_packed);
+    ASSERT_S(NULL != new_packed, jscon_strerror(JSCON_EXT__OUT_MEM, new_packed));
+    *new_packed = *packed;
+
+    size_t size;
+    switch (packed->type){
+    case JSCON_INTEGER:
+        size = packed->len * sizeof *packed->i_number;
+        break;
+    case JSCON_DOUBLE:
+        size = packed->len * sizeof *packed->d_number;
+        break;
+    case JSCON_BOOLEAN:
+        size = packed->len * sizeof *packed->boolean;
+        break;
+    default:
+        ERROR("Unknown packed type found\n\tCode: %d", packed->type);
+    }
+
+    new_packed->i_number = malloc(size); /* any member will do */
+    ASSERT_S(NULL != new_packed->i_number, jscon_strerror(JSCON_EXT__OUT_MEM, new_packed->i_number));
+    memcpy(new_packed->i_number, packed->i_number, size);
+
+    return new_packed;
+}
+
+static void
+_jscon_composite_clone(jscon_item_t *new_item, jscon_item_t *item, bool is_shared)
+{
+    jscon_composite_t *new_comp = calloc(1, sizeof *new_comp);
+    ASSERT_S(NULL != new_comp, jscon_strerror(JSCON_EXT__OUT_MEM, new_comp));
+    new_item->comp = new_comp;
+
+    /* branches are cloned once accessed. the source's whole tree is
+        kept alive by its root, so that items read from it can still
+        be navigated by their parents */
+    if (is_shared){
+        if (NULL != item->comp->source){ /* clone from the same source */
+            item = item->comp->source;
+        }
+        jscon_item_t *root = jscon_get_root(item);
+        atomic_fetch_add_explicit(&root->comp->refcount, 1, memory_order_relaxed);
+        new_comp->source = item;
+        return;
+    }
+
+    /* read from the source of a shared clone, without materializing it */
+    if (NULL != item->comp->source){
+        item = item->comp->source;
+    }
+    jscon_composite_t *comp = item->comp;
+
+    if (NULL != comp->packed){
+        new_comp->packed = _jscon_packed_clone(comp->packed);
+        return;
+    }
+
+    new_comp->branch = malloc((1+jscon_size(item)) * sizeof(jscon_item_t*));
+    ASSERT_S(NULL != new_comp->branch, jscon_strerror(JSCON_EXT__OUT_MEM, new_comp->branch));
+    new_comp->max_branch = 1+jscon_size(item);
+
+    for (size_t i=0; i < comp->num_branch; ++i){
+        jscon_item_t *branch = comp->branch[i];
+        if (NULL == branch) continue; /* skip dettached */
+
+        jscon_item_t *new_branch = Jscon_item_clone(branch, false);
+        if (NULL != comp->shape){
+            new_branch->key = branch->key;
+            new_branch->flags |= JSCON_ITEM_SHARED_KEY;
+        } else {
+            new_branch->key = strdup(branch->key);
+            ASSERT_S(NULL != new_branch->key, jscon_strerror(JSCON_EXT__OUT_MEM, new_branch->key));
+        }
+        new_branch->key_len = branch->key_len;
+        new_branch->key_hash = branch->key_hash;
+        new_branch->parent = new_item;
+        new_branch->index = new_comp->num_branch;
+
+        new_comp->branch[new_comp->num_branch++] = new_branch;
+    }
+
+    if (NULL != comp->shape){
+        new_comp->shape = comp->shape;
+        ++comp->shape->refcount;
+        return;
+    }
+
+    new_comp->hashtable = hashtable_init();
+    ASSERT_S(NULL != new_comp->hashtable, jscon_strerror(JSCON_EXT__OUT_MEM, new_comp->hashtable));
+
+    Jscon_composite_build(new_item);
+}
+
+/* clone item's value into a new item, its key is left for the caller
+    to set. if is_shared, item should be frozen: its composites
+    branches are only cloned once accessed (check
+    Jscon_composite_expand()) */
+jscon_item_t*
+Jscon_item_clone(jscon_item_t *item, bool is_shared)
+{
+    jscon_item_t *new_item = calloc(1, sizeof *new_item);
+    ASSERT_S(NULL != new_item, jscon_strerror(JSCON_EXT__OUT_MEM, new_item));
+
+    new_item->type = item->type;
+    switch (item->type){
+    case JSCON_OBJECT:
+    case JSCON_ARRAY:
+        _jscon_composite_clone(new_item, item, is_shared);
+        break;
+    case JSCON_STRING:
+        new_item->string = strdup(item->string);
+        ASSERT_S(NULL != new_item->string, jscon_strerror(JSCON_EXT__OUT_MEM, new_item->string));
+        break;
+    case JSCON_INTEGER:
+    case JSCON_DOUBLE:
+        if (IS_LAZY_NUMBER(item)){ /* keep its source text */
+            size_t size = sizeof *item->lazynum + strlen(item->lazynum->text) + 1;
+
+            new_item->lazynum = malloc(size);
+            ASSERT_S(NULL != new_item->lazynum, jscon_strerror(JSCON_EXT__OUT_MEM, new_item->lazynum));
+            memcpy(new_item->lazynum, item->lazynum, size);
+            new_item->flags |= JSCON_ITEM_LAZY_NUMBER;
+        }
+        else if (JSCON_INTEGER == item->type){
+            new_item->i_number = item->i_number;
+        }
+        else {
+            new_item->d_number = item->d_number;
+        }
+        break;
+    case JSCON_BOOLEAN:
+        new_item->boolean = item->boolean;
+        break;
+    default: /* JSCON_NULL */
+        break;
+    }
+
+    return new_item;
+}
+
 jscon_composite_t*
 Jscon_decode_composite(char **p_buffer, size_t n_branch){
-    jscon_composite_t *new_comp = calloc(1, sizeof *new_comp);
+    jscon_composite_t *new_comp = Jscon_calloc(1, sizeof *new_comp);
     ASSERT_S(NULL != new_comp, jscon_strerror(JSCON_EXT__OUT_MEM, new_comp));
 
     new_comp->hashtable = hashtable_init(); 
     ASSERT_S(NULL != new_comp->hashtable, jscon_strerror(JSCON_EXT__OUT_MEM, new_comp->hashtable));
 
-    new_comp->branch = malloc((1+n_branch) * sizeof(jscon_item_t*));
+    new_comp->branch = Jscon_malloc((1+n_branch) * sizeof(jscon_item_t*));
     ASSERT_S(NULL != new_comp->branch, jscon_strerror(JSCON_EXT__OUT_MEM, new_comp->branch));
+    new_comp->max_branch = 1+n_branch;
 
     ++*p_buffer; /* skips composite's '{' or '[' delim */
 
     return new_comp;
 }
 
-char*
-Jscon_decode_string(char **p_buffer)
+/* decode string and set p_len to its length */
+static char*
+_jscon_decode_string(char **p_buffer, size_t *p_len)
 {
     char *start = *p_buffer;
     ASSERT_S('\"' == *start, jscon_strerror(JSCON_EXT__INVALID_STRING, start)); /* makes sure a string is given */
@@ -126,12 +869,33 @@ Jscon_decode_string(char **p_buffer)
 
     *p_buffer = end + 1; /* skips double quotes buffer position */
 
-    char *set_str = strndup(start, end-start);
+    char *set_str = Jscon_strndup(start, end-start);
     ASSERT_S(NULL != set_str, jscon_strerror(JSCON_EXT__OUT_MEM, set_str));
 
+    *p_len = end-start;
+
     return set_str;
 }
 
+char*
+Jscon_decode_string(char **p_buffer)
+{
+    size_t len;
+    return _jscon_decode_string(p_buffer, &len);
+}
+
+/* decode an object's key, its length and hash are set at p_len and
+    p_hash, and should be cached at the item that receives it */
+char*
+Jscon_decode_key(char **p_buffer, size_t *p_len, uint64_t *p_hash)
+{
+    char *set_key = _jscon_decode_string(p_buffer, p_len);
+    /* hash the copy, while its still cached */
+    *p_hash = hashtable_genhash(set_key, *p_len);
+
+    return set_key;
+}
+
 void
 Jscon_decode_static_string(char **p_buffer, const long len, const long offset, char set_str[])
 {
@@ -153,10 +917,11 @@ Jscon_decode_static_string(char **p_buffer, const long len, const long offset, c
     strscpy(set_str + offset, start, (end-start)+1);
 }
 
-double
-Jscon_decode_double(char **p_buffer)
+/* skips a number's tokens, and return the first non-number char
+ *  address found */
+char*
+Jscon_skip_number(char *start)
 {
-    char *start = *p_buffer;
     char *end = start;
 
     /* 1st STEP: check for a minus sign and skip it */
@@ -187,7 +952,16 @@ Jscon_decode_double(char **p_buffer)
             continue;
     }
 
-    /* 5th STEP: convert string to double and return its value */
+    return end;
+}
+
+double
+Jscon_decode_double(char **p_buffer)
+{
+    char *start = *p_buffer;
+    char *end = Jscon_skip_number(start);
+
+    /* convert string to double and return its value */
     char numstr[MAX_INTEGER_DIG];
     strscpy(numstr, start, ((size_t)(end-start+1) < sizeof(numstr)) ? (size_t)(end-start+1) : sizeof(numstr));
 
@@ -199,6 +973,43 @@ Jscon_decode_double(char **p_buffer)
     return set_double;
 }
 
+/* copy the number's source text without converting it, p_is_integer
+ *  is set if the text has no fraction or exponent part */
+jscon_lazynum_t*
+Jscon_decode_lazynum(char **p_buffer, bool *p_is_integer)
+{
+    char *start = *p_buffer;
+    char *end = Jscon_skip_number(start);
+
+    jscon_lazynum_t *new_lazynum = Jscon_malloc(sizeof *new_lazynum + (end-start) + 1);
+    ASSERT_S(NULL != new_lazynum, jscon_strerror(JSCON_EXT__OUT_MEM, new_lazynum));
+
+    new_lazynum->is_cached = false;
+    memcpy(new_lazynum->text, start, end-start);
+    new_lazynum->text[end-start] = '\0';
+
+    *p_is_integer = (NULL == strpbrk(new_lazynum->text, ".eE"));
+
+    *p_buffer = end; /* skips entire length of number */
+
+    return new_lazynum;
+}
+
+/* convert lazy number text to the item's type, and cache it */
+void
+Jscon_lazynum_resolve(jscon_item_t *item)
+{
+    jscon_lazynum_t *lazynum = item->lazynum;
+    if (lazynum->is_cached) return;
+
+    if (JSCON_INTEGER == item->type){
+        lazynum->i_number = strtoll(lazynum->text, NULL, 10);
+    } else {
+        lazynum->d_number = strtod(lazynum->text, NULL);
+    }
+    lazynum->is_cached = true;
+}
+
 bool
 Jscon_decode_boolean(char **p_buffer)
 {
@@ -24,6 +24,9 @@
 #define JSCON_COMMON_H_
 
 #include <limits.h>
+#include <stdint.h>
+#include <stdatomic.h>
+#include <string.h>
 
 /* #include <libjscon.h> (implicit) */
 #include "hashtable.h"
@@ -34,6 +37,7 @@
 #define JSCON_VERSION "0.0"
 
 #define MAX_INTEGER_DIG 20 /* ULLONG_MAX maximum amt of digits possible */
+#define MAX_NESTING_DEPTH 1024 /* jscon_validate() maximum composite depth */
 
 typedef enum jscon_errcode
 {
@@ -70,8 +74,31 @@ char *__jscon_strerror(jscon_errcode code, char codetag[], void *where, char ent
 #define DOUBLE_IS_INTEGER(d) \
     ((d) <= LLONG_MIN || (d) >= LLONG_MAX || (d) == (long long)(d))
 
-#define IS_BLANK_CHAR(c) (isspace(c) || iscntrl(c))
+#define IS_BLANK_CHAR(c) (('\0' != (c)) && (isspace(c) || iscntrl(c)))
 #define CONSUME_BLANK_CHARS(str) for( ; IS_BLANK_CHAR(*str) ; ++str)
+/* whitespace as per RFC 8259 (stricter than IS_BLANK_CHAR) */
+#define IS_JSON_WHITESPACE(c) (' ' == (c) || '\n' == (c) || '\r' == (c) || '\t' == (c))
+
+/* SWAR (SIMD within a register) helpers, for scanning 8 bytes of
+ *  text per operation in a portable manner:
+ *      SWAR_LOAD: reads 8 bytes from a (possibly unaligned) address
+ *      SWAR_HAS_BYTE: nonzero if any byte of x equals c
+ *      SWAR_HAS_LESS: nonzero if any byte of x is less than n (n <= 128)
+ *      SWAR_HAS_HIGH: nonzero if any byte of x is non-ASCII */
+#define SWAR_ONES  0x0101010101010101ULL
+#define SWAR_HIGHS 0x8080808080808080ULL
+
+static inline uint64_t
+SWAR_LOAD(const char *str){
+    uint64_t x;
+    memcpy(&x, str, sizeof x);
+    return x;
+}
+
+#define SWAR_HAS_ZERO(x) (((x) - SWAR_ONES) & ~(x) & SWAR_HIGHS)
+#define SWAR_HAS_BYTE(x,c) SWAR_HAS_ZERO((x) ^ (SWAR_ONES * (unsigned char)(c)))
+#define SWAR_HAS_LESS(x,n) (((x) - SWAR_ONES * (n)) & ~(x) & SWAR_HIGHS)
+#define SWAR_HAS_HIGH(x) ((x) & SWAR_HIGHS)
 
 #define IS_COMPOSITE(item) ((item) && jscon_typecmp(item, JSCON_OBJECT|JSCON_ARRAY))
 #define IS_EMPTY_COMPOSITE(item) (IS_COMPOSITE(item) && 0 == jscon_size(item))
@@ -80,6 +107,44 @@ char *__jscon_strerror(jscon_errcode code, char codetag[], void *where, char ent
 #define IS_ELEMENT(item) (jscon_typecmp(item->parent, JSCON_ARRAY))
 #define IS_LEAF(item) (IS_PRIMITIVE(item) || IS_EMPTY_COMPOSITE(item))
 #define IS_ROOT(item) (NULL == item->parent)
+#define IS_PACKED(item) (JSCON_ARRAY == (item)->type && NULL != (item)->comp->packed)
+
+
+/* JSCON SHAPE STRUCTURE
+ *  objects that share the same key sequence (ex: an array of records)
+ *  may reference a single immutable shape, instead of each one owning
+ *  its keys and hashtable:
+ *      key: the key strings, in branch order
+ *      num_key: amount of keys
+ *      hashtable: maps a key to its branch index (offset by one, so
+ *          that index 0 isn't mistaken for a missing key)
+ *      refcount: amount of objects referencing this shape */
+typedef struct jscon_shape_s {
+    char **key;
+    size_t num_key;
+
+    struct hashtable_s *hashtable;
+    size_t refcount;
+} jscon_shape_t;
+
+
+/* JSCON PACKED ARRAY STRUCTURE
+ *  homogeneous arrays of numbers or booleans may be stored as a
+ *  contiguous vector of values, instead of an item per element:
+ *      type: the elements datatype (JSCON_INTEGER, JSCON_DOUBLE or
+ *          JSCON_BOOLEAN)
+ *      len: amount of elements
+ *      union {i_number, d_number, boolean}: the vector, denoted by
+ *          type */
+typedef struct jscon_packed_s {
+    enum jscon_type type;
+    size_t len;
+    union {
+        long long *i_number;
+        double *d_number;
+        bool *boolean;
+    };
+} jscon_packed_t;
 
 
 /* JSCON COMPOSITE STRUCTURE
@@ -87,41 +152,134 @@ char *__jscon_strerror(jscon_errcode code, char codetag[], void *where, char ent
  *  include a jscon_composite_t struct with the following attributes:
  *      branch: for sorting through object's properties/array elements
  *      num_branch: amount of enumerable properties/elements contained
+ *          (counting the num_deleted ones)
+ *      max_branch: amount of branch slots allocated
+ *      num_deleted: amount of dettached branches, left as NULL slots
+ *          until the composite is compacted (check Jscon_composite_compact())
+ *      src_offset: where the composite's source text starts, relative
+ *          to its parent's start (or to the buffer's start, if root)
+ *      src_len: the composite's source text length, including its
+ *          delimiters (0 if unknown, ex: not created by the parser)
  *      last_accessed_branch: simulate stack trace by storing the last
  *          accessed branch address. this is used for movement 
  *          functions that require state to be preserved between 
  *          calls, while also adhering to tree traversal rules. 
  *          (check public.c jscon_iter_next() for example)
- *      hashtable: easy reference to its key-value pairs
- *      p_item: reference to the item the composite is part of
- *      next: points to next composite
- *      prev: points to previous composite */
+ *      hashtable: easy reference to its key-value pairs (NULL if shape
+ *          or perfect is set)
+ *      perfect: minimal perfect hash of its keys, if frozen (check
+ *          Jscon_composite_freeze()), or if cloned from a frozen
+ *          source and its branches weren't modified since
+ *      shape: shared key sequence, if composite is an object that
+ *          matches its previous sibling keys (check jscon_shape_t)
+ *      packed: array's elements vector, if they haven't been expanded
+ *          into branches yet (check jscon_packed_t)
+ *      source: frozen composite whose branches are yet to be cloned,
+ *          if composite is a shared clone (check jscon_clone_ex()). a
+ *          frozen shared clone is never cloned into, its branches are
+ *          read from source instead
+ *      refcount: if composite is a frozen root, the amount of shared
+ *          clones whose source is within its tree, plus one for its
+ *          owner. the tree is only destroyed along with its last
+ *          reference (check Jscon_composite_release())
+ */
 typedef struct jscon_composite_s {
     struct jscon_item_s **branch;
     size_t num_branch;
+    size_t max_branch;
+    size_t num_deleted;
     size_t last_accessed_branch;
 
+    size_t src_offset;
+    size_t src_len;
+
     struct hashtable_s *hashtable;
-    struct jscon_item_s *p_item;
-    struct jscon_composite_s *next;
-    struct jscon_composite_s *prev;
+    uint32_t *perfect;
+    jscon_shape_t *shape;
+    jscon_packed_t *packed;
+    struct jscon_item_s *source;
+    atomic_size_t refcount;
 } jscon_composite_t;
 
 
-void Jscon_composite_link_r(struct jscon_item_s *item, jscon_composite_t **last_accessed_comp);
 void Jscon_composite_build(struct jscon_item_s *item);
 struct jscon_item_s* Jscon_composite_get(const char *key, struct jscon_item_s *item);
+struct jscon_item_s* Jscon_composite_get_h(const char *key, uint64_t hash, struct jscon_item_s *item, size_t *p_index);
 struct jscon_item_s* Jscon_composite_set(const char *key, struct jscon_item_s *item);
 void Jscon_composite_remake(jscon_item_t *item);
+bool Jscon_composite_share(struct jscon_item_s *item, struct jscon_item_s *sibling);
+void Jscon_composite_unshare(struct jscon_item_s *item);
+void Jscon_shape_release(jscon_shape_t *shape);
+void Jscon_composite_expand(struct jscon_item_s *item);
+void Jscon_composite_compact(struct jscon_item_s *item);
+bool Jscon_composite_freeze(struct jscon_item_s *item);
+void Jscon_packed_destroy(jscon_packed_t *packed);
+struct jscon_item_s* Jscon_item_clone(struct jscon_item_s *item, bool is_shared);
+void Jscon_composite_release(struct jscon_item_s *item);
+bool Jscon_composite_has_repeats(struct jscon_item_s *item);
+
+
+/* JSCON LAZY NUMBER STRUCTURE
+ *  number items created with JSCON_PARSE_LAZY_NUMBER keep their
+ *  source text, and only convert it when its value is requested:
+ *      is_cached: whether text has been converted to value already
+ *      union {d_number, i_number}: the cached value, denoted by the
+ *          item's type
+ *      text: the number's source digits, copied verbatim */
+typedef struct jscon_lazynum_s {
+    bool is_cached;
+    union {
+        double d_number;
+        long long i_number;
+    };
+    char text[];
+} jscon_lazynum_t;
+
+
+/* JSCON ITEM FLAGS
+ *  internal state bits stored at item->flags
+ *      JSCON_ITEM_LAZY_NUMBER: number value is kept at item->lazynum
+ *      JSCON_ITEM_SHARED_KEY: item->key is owned by its parent's shape
+ *      JSCON_ITEM_ARENA: item is placed at a caller's memory block, and
+ *          can't be modified or freed individually
+ *      JSCON_ITEM_FROZEN: item belongs to a tree that went through
+ *          jscon_freeze(), and can't be modified
+ *      JSCON_ITEM_CHANGED: item's value was changed by the ongoing
+ *          jscon_parse_update(), and is yet to be reported
+ *  a root item also keeps the jscon_parse_ex() flags it was parsed with,
+ *  from JSCON_ITEM_PARSE_SHIFT on, so that the spans re-parsed into
+ *  its tree are parsed alike (check jscon_reparse()) */
+enum jscon_item_flags {
+    JSCON_ITEM_LAZY_NUMBER  = 1 << 0,
+    JSCON_ITEM_SHARED_KEY   = 1 << 1,
+    JSCON_ITEM_ARENA        = 1 << 2,
+    JSCON_ITEM_FROZEN       = 1 << 3,
+    JSCON_ITEM_CHANGED      = 1 << 4,
+};
+
+#define JSCON_ITEM_PARSE_SHIFT 8
+#define JSCON_ITEM_PARSE_MASK (~0u << JSCON_ITEM_PARSE_SHIFT)
+#define ROOT_PARSE_FLAGS(root) ((int)((root)->flags >> JSCON_ITEM_PARSE_SHIFT))
+
+#define IS_LAZY_NUMBER(item) ((item)->flags & JSCON_ITEM_LAZY_NUMBER)
+#define IS_ARENA(item) ((item)->flags & JSCON_ITEM_ARENA)
+#define IS_FROZEN(item) ((item)->flags & JSCON_ITEM_FROZEN)
+/* branches can't be added, removed or reallocated */
+#define IS_READ_ONLY(item) ((item)->flags & (JSCON_ITEM_ARENA|JSCON_ITEM_FROZEN))
 
 
 /* JSCON ITEM STRUCTURE
  *  key: item's jscon key (NULL if root)
+ *  key_len, key_hash: cached key length and hash, used for building
+ *      its parent's hashtable without going over the key again
  *  parent: object or array that its part of (NULL if root)
+ *  index: item's position at its parent branches (0 if root)
  *  type: item's jscon datatype (check enum jscon_type_e for flags) 
- *  union {string, d_number, i_number, boolean, comp}:
+ *  flags: item's internal state (check enum jscon_item_flags)
+ *  union {string, d_number, i_number, boolean, comp, lazynum}:
  *      string,d_number,i_number,boolean: item literal value, denoted 
- *      by its type.  */
+ *      by its type.
+ *      lazynum: number literal value, if JSCON_ITEM_LAZY_NUMBER is set */
 typedef struct jscon_item_s {
     union {
         char *string;
@@ -129,19 +287,30 @@ typedef struct jscon_item_s {
         long long i_number;
         bool boolean;
         jscon_composite_t *comp;
+        jscon_lazynum_t *lazynum;
     };
     enum jscon_type type;
+    unsigned int flags;
 
     char *key;
+    size_t key_len;
+    uint64_t key_hash; /* 0 if not computed yet (check Jscon_key_hash()) */
     struct jscon_item_s *parent;
+    size_t index;
 } jscon_item_t;
 
 /*
  * jscon-common.c
  */
 char* Jscon_decode_string(char **p_buffer);
+char* Jscon_decode_key(char **p_buffer, size_t *p_len, uint64_t *p_hash);
+uint64_t Jscon_key_hash(jscon_item_t *item);
+bool Jscon_composite_reserve(jscon_item_t *item, size_t max_branch);
 void Jscon_decode_static_string(char **p_buffer, const long len, const long offset, char set_str[]);
+char* Jscon_skip_number(char *start);
 double Jscon_decode_double(char **p_buffer);
+jscon_lazynum_t* Jscon_decode_lazynum(char **p_buffer, bool *p_is_integer);
+void Jscon_lazynum_resolve(jscon_item_t *item);
 bool Jscon_decode_boolean(char **p_buffer);
 void Jscon_decode_null(char **p_buffer);
 jscon_composite_t* Jscon_decode_composite(char **p_buffer, size_t n_branch);
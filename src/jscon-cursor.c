@@ -0,0 +1,139 @@
+/*
+ * Copyright (c) 2020 Lucas Müller
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <libjscon.h>
+
+#include "jscon-common.h"
+#include "debug.h"
+
+
+/* unlike jscon_iter_next(), the traversal state is kept at the cursor,
+    and branches are reached from the stack instead of the items'
+    parents. the composites positions aren't compacted either, dettached
+    branches slots are skipped instead. the only writes to the tree are
+    done by Jscon_composite_expand(), which is a no-op for read-only
+    trees */
+
+static inline struct jscon_cursor_frame_s*
+_jscon_cursor_stack(jscon_cursor_t *cursor){
+    return (NULL != cursor->stack) ? cursor->stack : cursor->local;
+}
+
+static void
+_jscon_cursor_push(jscon_cursor_t *cursor, jscon_item_t *item)
+{
+    if (cursor->depth == cursor->max_depth){
+        struct jscon_cursor_frame_s *tmp = realloc(cursor->stack, 2 * cursor->max_depth * sizeof *tmp);
+        ASSERT_S(NULL != tmp, jscon_strerror(JSCON_EXT__OUT_MEM, tmp));
+
+        if (NULL == cursor->stack){ /* move local frames over */
+            memcpy(tmp, cursor->local, sizeof cursor->local);
+        }
+        cursor->stack = tmp;
+        cursor->max_depth *= 2;
+    }
+
+    /* packed arrays and shared clones are settled before visited,
+        frozen shared clones are visited at their source instead */
+    Jscon_composite_expand(item);
+    if (NULL != item->comp->source){
+        item = item->comp->source;
+    }
+
+    struct jscon_cursor_frame_s *frame = &_jscon_cursor_stack(cursor)[cursor->depth++];
+    frame->item = item;
+    frame->index = 0;
+}
+
+void
+jscon_cursor_init(jscon_cursor_t *cursor, jscon_item_t *item, int mode)
+{
+    cursor->root = item;
+    cursor->mode = mode;
+    cursor->stack = NULL;
+    cursor->depth = 0;
+    cursor->max_depth = JSCON_CURSOR_LOCAL_DEPTH;
+
+    if (IS_COMPOSITE(item)){
+        _jscon_cursor_push(cursor, item);
+    }
+}
+
+/* return the next item, or NULL once there are no items left. the
+    root itself isn't returned */
+jscon_item_t*
+jscon_cursor_next(jscon_cursor_t *cursor)
+{
+    while (cursor->depth > 0){
+        struct jscon_cursor_frame_s *frame = &_jscon_cursor_stack(cursor)[cursor->depth-1];
+        jscon_composite_t *comp = frame->item->comp;
+
+        /* skip dettached branches slots */
+        while (frame->index < comp->num_branch && NULL == comp->branch[frame->index]){
+            ++frame->index;
+        }
+        if (frame->index == comp->num_branch){
+            --cursor->depth; /* all of its branches have been visited */
+            continue;
+        }
+
+        jscon_item_t *branch = comp->branch[frame->index++];
+        if (JSCON_CURSOR_PREORDER == cursor->mode && IS_COMPOSITE(branch)){
+            _jscon_cursor_push(cursor, branch);
+        }
+        return branch;
+    }
+
+    return NULL;
+}
+
+/* same as jscon_cursor_next(), but the item is split into its key
+    and value. return false once there are no items left */
+bool
+jscon_cursor_next_pair(jscon_cursor_t *cursor, const char **p_key, jscon_item_t **p_value)
+{
+    jscon_item_t *item = jscon_cursor_next(cursor);
+    if (NULL == item) return false;
+
+    if (NULL != p_key){
+        *p_key = item->key;
+    }
+    if (NULL != p_value){
+        *p_value = item;
+    }
+    return true;
+}
+
+/* release the cursor's resources, it may be initialized again */
+void
+jscon_cursor_cleanup(jscon_cursor_t *cursor)
+{
+    free(cursor->stack);
+    cursor->stack = NULL;
+    cursor->depth = 0;
+}
@@ -0,0 +1,162 @@
+/*
+ * Copyright (c) 2020 Lucas Müller
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdatomic.h>
+
+#include <libjscon.h>
+
+#include "jscon-common.h"
+#include "cdictionary.h"
+#include "debug.h"
+
+
+/* JSCON DOCUMENT STRUCTURE
+ *  a frozen tree that may be shared by threads, it's destroyed along
+ *  with its last reference:
+ *      root: the frozen tree
+ *      refcount: amount of references to the document */
+struct jscon_doc_s {
+    jscon_item_t *root;
+    atomic_size_t refcount;
+};
+
+/* JSCON DOCUMENT SLOT STRUCTURE
+ *  holds the current version of a document, which may be replaced
+ *  while other threads acquire it. readers never lock nor wait, the
+ *  replaced version is released once no reader can reach it:
+ *      versions: holds the current version at SLOT_KEY (its epoch
+ *          based reclamation is what delays the release) */
+struct jscon_doc_slot_s {
+    cdictionary_t *versions;
+};
+
+#define SLOT_KEY "doc"
+
+/* take ownership of root, which is frozen if it isn't already. the
+    document starts with a single reference */
+jscon_doc_t*
+jscon_doc_init(jscon_item_t *root)
+{
+    ASSERT_S(IS_ROOT(root), "Item is not root");
+
+    if (!IS_FROZEN(root)){
+        jscon_freeze(root);
+    }
+
+    jscon_doc_t *new_doc = malloc(sizeof *new_doc);
+    ASSERT_S(NULL != new_doc, jscon_strerror(JSCON_EXT__OUT_MEM, new_doc));
+
+    new_doc->root = root;
+    atomic_init(&new_doc->refcount, 1);
+
+    return new_doc;
+}
+
+jscon_doc_t*
+jscon_doc_retain(jscon_doc_t *doc)
+{
+    atomic_fetch_add_explicit(&doc->refcount, 1, memory_order_relaxed);
+    return doc;
+}
+
+/* drop a reference, the document is destroyed along with its last one */
+void
+jscon_doc_release(jscon_doc_t *doc)
+{
+    if (NULL == doc) return;
+
+    /* acquire, so that every other reference is done with it */
+    if (1 != atomic_fetch_sub_explicit(&doc->refcount, 1, memory_order_acq_rel))
+        return;
+
+    jscon_destroy(doc->root);
+    free(doc);
+}
+
+const jscon_item_t*
+jscon_doc_root(const jscon_doc_t *doc){
+    return doc->root;
+}
+
+/* same as jscon_get_branch(), for a document's item. frozen objects
+    are looked up without being written to */
+const jscon_item_t*
+jscon_doc_get_branch(const jscon_item_t *item, const char *key)
+{
+    ASSERT_S(IS_FROZEN(item), "Item doesn't belong to a document");
+
+    return Jscon_composite_get(key, (jscon_item_t*)item);
+}
+
+static void
+_jscon_doc_release_cb(void *doc){
+    jscon_doc_release(doc);
+}
+
+/* take doc's reference, as the slot's current version */
+jscon_doc_slot_t*
+jscon_doc_slot_init(jscon_doc_t *doc)
+{
+    jscon_doc_slot_t *new_slot = malloc(sizeof *new_slot);
+    ASSERT_S(NULL != new_slot, jscon_strerror(JSCON_EXT__OUT_MEM, new_slot));
+
+    new_slot->versions = cdictionary_init(1);
+    ASSERT_S(NULL != new_slot->versions, jscon_strerror(JSCON_EXT__OUT_MEM, new_slot->versions));
+
+    cdictionary_set(new_slot->versions, SLOT_KEY, doc, &_jscon_doc_release_cb);
+
+    return new_slot;
+}
+
+/* release the slot's reference to its current version */
+void
+jscon_doc_slot_destroy(jscon_doc_slot_t *slot)
+{
+    cdictionary_destroy(slot->versions);
+    free(slot);
+}
+
+/* return the slot's current version with a new reference, which
+    should be released once done with. never waits */
+jscon_doc_t*
+jscon_doc_acquire(jscon_doc_slot_t *slot)
+{
+    unsigned token = cdictionary_enter(slot->versions);
+    jscon_doc_t *doc = jscon_doc_retain(cdictionary_get(slot->versions, SLOT_KEY));
+    cdictionary_leave(slot->versions, token);
+
+    return doc;
+}
+
+/* take new_doc's reference as the slot's current version. readers
+    acquire either version until this returns, the previous version
+    reference is released once they're done acquiring it */
+void
+jscon_doc_swap(jscon_doc_slot_t *slot, jscon_doc_t *new_doc)
+{
+    cdictionary_set(slot->versions, SLOT_KEY, new_doc, &_jscon_doc_release_cb);
+    cdictionary_reclaim(slot->versions);
+}
@@ -0,0 +1,97 @@
+/*
+ * Copyright (c) 2020 Lucas Müller
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <libjscon.h>
+
+#include "jscon-common.h"
+
+
+/* copy string contents (after its opening double quotes) up to and
+    including its closing double quotes, return the amount of bytes copied */
+static size_t
+_jscon_minify_string(char *dest, const char *src, size_t len)
+{
+    size_t i = 0;
+    while (i < len){
+        /* copies 8 bytes at a time while there's no quotes or escapes */
+        while (len - i >= 8){
+            uint64_t x = SWAR_LOAD(src + i);
+            if (SWAR_HAS_BYTE(x, '\"') || SWAR_HAS_BYTE(x, '\\')) break;
+
+            memcpy(dest + i, &x, sizeof x);
+            i += 8;
+        }
+        if (i == len) break;
+
+        char c = src[i];
+        dest[i++] = c;
+        if ('\"' == c) break;
+        if ('\\' == c && i < len){ /* copies escaped char */
+            dest[i] = src[i];
+            ++i;
+        }
+    }
+
+    return i;
+}
+
+/* copy src to dest without the whitespace outside of strings, and
+    return the new length. dest must have room for len+1 bytes (output
+    is nul-terminated), and may be the same as src for compacting it
+    in place. the text itself isn't validated */
+size_t
+jscon_minify(char *dest, const char *src, size_t len)
+{
+    size_t i = 0; /* src position */
+    size_t n = 0; /* dest position */
+    while (i < len){
+        /* copies 8 bytes at a time while there's no whitespace (nor any
+            other char below '!') or strings starting */
+        while (len - i >= 8){
+            uint64_t x = SWAR_LOAD(src + i);
+            if (SWAR_HAS_LESS(x, 0x21) || SWAR_HAS_BYTE(x, '\"')) break;
+
+            memcpy(dest + n, &x, sizeof x);
+            i += 8;
+            n += 8;
+        }
+        if (i == len) break;
+
+        char c = src[i++];
+        if (IS_JSON_WHITESPACE(c)) continue;
+
+        dest[n++] = c;
+        if ('\"' == c){
+            size_t str_len = _jscon_minify_string(dest + n, src + i, len - i);
+            i += str_len;
+            n += str_len;
+        }
+    }
+    dest[n] = '\0';
+
+    return n;
+}
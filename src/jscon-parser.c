@@ -25,18 +25,30 @@
 #include <stdarg.h>
 #include <string.h>
 #include <ctype.h>
+#include <time.h>
+#include <sys/uio.h> /* for struct iovec */
 
 #include <libjscon.h>
 
 #include "jscon-common.h"
+#include "jscon-alloc.h"
 #include "debug.h"
 
 
 struct _jscon_utils_s {
     char *buffer;
+    char *origin; /* buffer's start, for recording composite source spans
+                    (NULL if unavailable) */
     char *key; /* holds key ptr to be received by item */
-    jscon_composite_t *last_accessed_comp; /* holds last composite accessed */
+    size_t key_len; /* key's length and hash, to be cached by item */
+    uint64_t key_hash;
     jscon_cb *parse_cb; /* parser callback */
+    int flags; /* jscon_parse_ex() option flags */
+    bool no_prescan; /* branches are counted as they're parsed, instead
+                        of looking ahead for the composite's end */
+    jscon_parse_limits_t limits; /* jscon_parse_ex() resource limits */
+    size_t depth; /* amount of composites currently open */
+    size_t num_node; /* amount of values created so far */
 };
 
 /* function pointers used while building json items, 
@@ -45,10 +57,19 @@ struct _jscon_utils_s {
 typedef void (jscon_create_value)(jscon_item_t *item, struct _jscon_utils_s *utils);
 typedef jscon_item_t* (jscon_create_item)(jscon_item_t*, struct _jscon_utils_s*, jscon_create_value*);
 
+/* abandon the parse if value exceeds limit (0 for unlimited), the
+    tree must be left in a destroyable state before this is called */
+static inline void
+_jscon_check_limit(size_t value, size_t limit, enum jscon_parse_errcode errcode)
+{
+    if (0 != limit && value > limit)
+        Jscon_alloc_fail(errcode);
+}
+
 static jscon_item_t*
 _jscon_item_init()
 {
-    jscon_item_t *new_item = calloc(1, sizeof *new_item);
+    jscon_item_t *new_item = Jscon_calloc(1, sizeof *new_item);
     ASSERT_S(NULL != new_item, jscon_strerror(JSCON_EXT__OUT_MEM, new_item));
 
     return new_item;
@@ -59,11 +80,23 @@ _jscon_item_init()
 static jscon_item_t*
 _jscon_branch_init(jscon_item_t *item)
 {
+    if (item->comp->num_branch == item->comp->max_branch){
+        /* branches weren't counted beforehand, grow geometrically */
+        jscon_item_t **tmp = Jscon_realloc(item->comp->branch,
+                                item->comp->max_branch * sizeof(jscon_item_t*),
+                                2 * item->comp->max_branch * sizeof(jscon_item_t*));
+        ASSERT_S(NULL != tmp, jscon_strerror(JSCON_EXT__OUT_MEM, tmp));
+        item->comp->branch = tmp;
+        item->comp->max_branch *= 2;
+    }
+
     ++item->comp->num_branch;
 
     item->comp->branch[item->comp->num_branch-1] = _jscon_item_init();
 
     item->comp->branch[item->comp->num_branch-1]->parent = item;
+    item->comp->branch[item->comp->num_branch-1]->index = item->comp->num_branch-1;
+    item->comp->branch[item->comp->num_branch-1]->flags |= item->flags & JSCON_ITEM_ARENA;
 
     return item->comp->branch[item->comp->num_branch-1];
 }
@@ -71,7 +104,19 @@ _jscon_branch_init(jscon_item_t *item)
 static void
 _jscon_composite_destroy(jscon_item_t *item)
 {
-    hashtable_destroy(item->comp->hashtable);
+    if (NULL != item->comp->source){
+        Jscon_composite_release(jscon_get_root(item->comp->source));
+    }
+
+    if (NULL != item->comp->packed){
+        Jscon_packed_destroy(item->comp->packed);
+    }
+
+    if (NULL != item->comp->shape){
+        Jscon_shape_release(item->comp->shape);
+    } else if (NULL != item->comp->hashtable){
+        hashtable_destroy(item->comp->hashtable);
+    }
 
     free(item->comp->branch);
     item->comp->branch = NULL;
@@ -80,14 +125,20 @@ _jscon_composite_destroy(jscon_item_t *item)
     item->comp = NULL;
 }
 
+static void _jscon_destroy_preorder(jscon_item_t *item);
+
+/* free the item's value (and its nested items, if composite),
+    but not the item itself */
 static void
-_jscon_destroy_preorder(jscon_item_t *item)
+_jscon_destroy_value(jscon_item_t *item)
 {
     switch (item->type){
     case JSCON_OBJECT:
     case JSCON_ARRAY:
         for (size_t i=0; i < item->comp->num_branch; ++i){
-            _jscon_destroy_preorder(item->comp->branch[i]);
+            if (NULL != item->comp->branch[i]){ /* skip dettached */
+                _jscon_destroy_preorder(item->comp->branch[i]);
+            }
         }
         _jscon_composite_destroy(item);
         break;
@@ -95,23 +146,92 @@ _jscon_destroy_preorder(jscon_item_t *item)
         free(item->string);
         item->string = NULL;
         break;
+    case JSCON_INTEGER:
+    case JSCON_DOUBLE:
+        if (IS_LAZY_NUMBER(item)){
+            free(item->lazynum);
+            item->lazynum = NULL;
+        }
+        break;
     default:
         break;
     }
+}
+
+static void
+_jscon_destroy_item(jscon_item_t *item)
+{
+    _jscon_destroy_value(item);
 
-    if (NULL != item->key){
+    if (NULL != item->key && !(item->flags & JSCON_ITEM_SHARED_KEY)){
         free(item->key);
-        item->key = NULL;
     }
+    item->key = NULL;
 
     free(item);
     item = NULL;
 }
 
+/* drop a reference to a frozen root, its tree is destroyed along
+    with its last one. until then it's kept as is, even if it has been
+    destroyed by its owner, so that its shared clones can still be
+    cloned into and their items navigated by their parents */
+void
+Jscon_composite_release(jscon_item_t *item)
+{
+    if (1 != atomic_fetch_sub_explicit(&item->comp->refcount, 1, memory_order_acq_rel))
+        return;
+
+    _jscon_destroy_item(item);
+}
+
+static void
+_jscon_destroy_preorder(jscon_item_t *item)
+{
+    /* drop its owner's reference */
+    if (IS_FROZEN(item) && IS_ROOT(item) && IS_COMPOSITE(item)){
+        Jscon_composite_release(item);
+        return;
+    }
+
+    _jscon_destroy_item(item);
+}
+
 /* destroy current item and all of its nested object/arrays */
 void
 jscon_destroy(jscon_item_t *item){
-    _jscon_destroy_preorder(jscon_get_root(item));
+    item = jscon_get_root(item);
+    /* memory block trees are released along with the block */
+    if (IS_ARENA(item)) return;
+
+    _jscon_destroy_preorder(item);
+}
+
+/* record where the composite's source text starts, its offset is
+    kept absolute until its parent is wrapped */
+static void
+_jscon_span_start(jscon_item_t *item, char *start, struct _jscon_utils_s *utils)
+{
+    if (NULL == utils->origin) return;
+
+    item->comp->src_offset = start - utils->origin;
+}
+
+/* record the composite's source text length (buffer is past its
+    closing delim), and make its branches offsets relative to it */
+static void
+_jscon_span_end(jscon_item_t *item, struct _jscon_utils_s *utils)
+{
+    if (NULL == utils->origin) return;
+
+    jscon_composite_t *comp = item->comp;
+    comp->src_len = (utils->buffer - utils->origin) - comp->src_offset;
+
+    for (size_t i=0; i < comp->num_branch; ++i){
+        if (IS_COMPOSITE(comp->branch[i])){
+            comp->branch[i]->comp->src_offset -= comp->src_offset;
+        }
+    }
 }
 
 /* fetch string type jscon and return allocated string */
@@ -127,6 +247,15 @@ _jscon_value_set_string(jscon_item_t *item, struct _jscon_utils_s *utils)
 static void
 _jscon_value_set_number(jscon_item_t *item, struct _jscon_utils_s *utils)
 {
+    if (utils->flags & JSCON_PARSE_LAZY_NUMBER){
+        /* keep source text, conversion is done by the getters */
+        bool is_integer;
+        item->lazynum = Jscon_decode_lazynum(&utils->buffer, &is_integer);
+        item->type = is_integer ? JSCON_INTEGER : JSCON_DOUBLE;
+        item->flags |= JSCON_ITEM_LAZY_NUMBER;
+        return;
+    }
+
     double set_double = Jscon_decode_double(&utils->buffer);
     if (DOUBLE_IS_INTEGER(set_double)){
         item->type = JSCON_INTEGER;
@@ -196,10 +325,17 @@ _jscon_count_property(char *buffer)
 static void
 _jscon_value_set_object(jscon_item_t *item, struct _jscon_utils_s *utils)
 {
+    _jscon_check_limit(++utils->depth, utils->limits.max_depth, JSCON_PARSE_ERR_DEPTH);
+
+    size_t n_branch = utils->no_prescan ? 0 : _jscon_count_property(utils->buffer);
+    /* fail before the branches vector is allocated */
+    _jscon_check_limit(utils->num_node + n_branch, utils->limits.max_nodes, JSCON_PARSE_ERR_NODES);
+
     item->type = JSCON_OBJECT;
 
-    item->comp = Jscon_decode_composite(&utils->buffer, _jscon_count_property(utils->buffer));
-    Jscon_composite_link_r(item, &utils->last_accessed_comp);
+    char *start = utils->buffer;
+    item->comp = Jscon_decode_composite(&utils->buffer, n_branch);
+    _jscon_span_start(item, start, utils);
 }
 
 inline static size_t
@@ -244,13 +380,134 @@ _jscon_count_element(char *buffer)
     abort();
 }
 
+/* try to store a homogeneous array of integers, doubles or booleans
+    as a vector, if any other datatype (or a mix of integers and
+    doubles) is found then nothing is consumed and false is returned.
+    numbers that keep their source text aren't packed */
+static bool
+_jscon_try_pack(jscon_item_t *item, struct _jscon_utils_s *utils)
+{
+    char *buffer = utils->buffer + 1; /* skips '[' */
+    CONSUME_BLANK_CHARS(buffer);
+
+    jscon_packed_t packed = {0};
+    switch (*buffer){
+    case 't': case 'f':
+        packed.type = JSCON_BOOLEAN;
+        break;
+    case '-': case '0': case '1': case '2':
+    case '3': case '4': case '5': case '6':
+    case '7': case '8': case '9':
+        if (utils->flags & JSCON_PARSE_LAZY_NUMBER) return false;
+
+        packed.type = JSCON_DOUBLE; /* narrowed to integer if possible */
+        break;
+    default:
+        return false;
+    }
+
+    bool is_integer = true, is_double = true; /* same as each element would be */
+    size_t max_len = 0;
+    while (true){
+        if (packed.len == max_len){
+            max_len = (0 == max_len) ? 8 : 2 * max_len;
+
+            /* all types share the same size, any member will do */
+            void *tmp = Jscon_realloc(packed.d_number, packed.len * sizeof(double), max_len * sizeof(double));
+            ASSERT_S(NULL != tmp, jscon_strerror(JSCON_EXT__OUT_MEM, tmp));
+            packed.d_number = tmp;
+        }
+
+        if (JSCON_BOOLEAN == packed.type){
+            if (STRNEQ(buffer,"true",4))
+                packed.boolean[packed.len] = true;
+            else if (STRNEQ(buffer,"false",5))
+                packed.boolean[packed.len] = false;
+            else
+                goto not_packed;
+
+            buffer += packed.boolean[packed.len] ? 4 : 5;
+        } else {
+            if ('-' != *buffer && !isdigit(*buffer))
+                goto not_packed;
+
+            char *end = Jscon_skip_number(buffer);
+            packed.d_number[packed.len] = strtod(buffer, NULL);
+            buffer = end;
+
+            if (DOUBLE_IS_INTEGER(packed.d_number[packed.len]))
+                is_double = false;
+            else
+                is_integer = false;
+
+            if (!is_integer && !is_double)
+                goto not_packed;
+        }
+        ++packed.len;
+
+        CONSUME_BLANK_CHARS(buffer);
+        if (',' == *buffer){
+            ++buffer; /* skips ',' */
+            CONSUME_BLANK_CHARS(buffer);
+            continue;
+        }
+        if (']' == *buffer){
+            ++buffer; /* skips ']' */
+            break;
+        }
+        goto not_packed;
+    }
+
+    if (JSCON_DOUBLE == packed.type && is_integer){
+        /* doubles are converted in place, as both types have the same size */
+        packed.type = JSCON_INTEGER;
+        for (size_t i=0; i < packed.len; ++i){
+            packed.i_number[i] = (long long)packed.d_number[i];
+        }
+    }
+
+    item->comp = calloc(1, sizeof *item->comp);
+    ASSERT_S(NULL != item->comp, jscon_strerror(JSCON_EXT__OUT_MEM, item->comp));
+
+    item->comp->packed = malloc(sizeof *item->comp->packed);
+    ASSERT_S(NULL != item->comp->packed, jscon_strerror(JSCON_EXT__OUT_MEM, item->comp->packed));
+
+    *item->comp->packed = packed;
+
+    utils->buffer = buffer;
+
+    return true;
+
+not_packed:
+    Jscon_free(packed.d_number);
+    return false;
+}
+
 static void
 _jscon_value_set_array(jscon_item_t *item, struct _jscon_utils_s *utils)
 {
+    _jscon_check_limit(++utils->depth, utils->limits.max_depth, JSCON_PARSE_ERR_DEPTH);
+
+    char *start = utils->buffer;
+    if ((utils->flags & JSCON_PARSE_PACK_ARRAYS) && _jscon_try_pack(item, utils)){
+        item->type = JSCON_ARRAY;
+        --utils->depth; /* packed arrays are wrapped already */
+        _jscon_span_start(item, start, utils);
+        _jscon_span_end(item, utils);
+
+        utils->num_node += item->comp->packed->len;
+        _jscon_check_limit(utils->num_node, utils->limits.max_nodes, JSCON_PARSE_ERR_NODES);
+        return;
+    }
+
+    size_t n_branch = utils->no_prescan ? 0 : _jscon_count_element(utils->buffer);
+    /* fail before the branches vector is allocated */
+    _jscon_check_limit(utils->num_node + n_branch, utils->limits.max_nodes, JSCON_PARSE_ERR_NODES);
+
     item->type = JSCON_ARRAY;
 
-    item->comp = Jscon_decode_composite(&utils->buffer, _jscon_count_element(utils->buffer));
-    Jscon_composite_link_r(item, &utils->last_accessed_comp);
+    item->comp = Jscon_decode_composite(&utils->buffer, n_branch);
+    _jscon_span_start(item, start, utils);
 }
 
 /* create nested composite type (object/array) and return 
@@ -258,13 +515,20 @@ _jscon_value_set_array(jscon_item_t *item, struct _jscon_utils_s *utils)
 static jscon_item_t*
 _jscon_composite_init(jscon_item_t *item, struct _jscon_utils_s *utils, jscon_create_value *value_setter)
 {
+    _jscon_check_limit(++utils->num_node, utils->limits.max_nodes, JSCON_PARSE_ERR_NODES);
+
     item = _jscon_branch_init(item);
     item->key = utils->key;
+    item->key_len = utils->key_len;
+    item->key_hash = utils->key_hash;
     utils->key = NULL;
 
     (*value_setter)(item, utils);
     item = (utils->parse_cb)(item);
 
+    if (IS_PACKED(item)) /* packed arrays are wrapped already */
+        return item->parent;
+
     return item;
 }
 
@@ -274,6 +538,20 @@ static jscon_item_t*
 _jscon_wrap_composite(jscon_item_t *item, struct _jscon_utils_s *utils)
 {
     ++utils->buffer; /* skips '}' or ']' */
+    --utils->depth;
+    _jscon_span_end(item, utils);
+
+    if ((utils->flags & JSCON_PARSE_SHARE_SHAPES)
+        && JSCON_OBJECT == item->type
+        && !IS_ROOT(item) && IS_ELEMENT(item)
+        && item->parent->comp->num_branch > 1)
+    {
+        /* try sharing keys with previous element */
+        jscon_composite_t *parent_comp = item->parent->comp;
+        if (Jscon_composite_share(item, parent_comp->branch[parent_comp->num_branch-2]))
+            return item->parent;
+    }
+
     Jscon_composite_build(item);
     return item->parent;
 }
@@ -282,8 +560,12 @@ _jscon_wrap_composite(jscon_item_t *item, struct _jscon_utils_s *utils)
 static jscon_item_t*
 _jscon_append_primitive(jscon_item_t *item, struct _jscon_utils_s *utils, jscon_create_value *value_setter)
 {
+    _jscon_check_limit(++utils->num_node, utils->limits.max_nodes, JSCON_PARSE_ERR_NODES);
+
     item = _jscon_branch_init(item);
     item->key = utils->key;
+    item->key_len = utils->key_len;
+    item->key_hash = utils->key_hash;
     utils->key = NULL;
 
     (*value_setter)(item, utils);
@@ -364,11 +646,12 @@ _jscon_array_build(jscon_item_t *item, struct _jscon_utils_s *utils)
      {
         /* creates numerical key for the array element */
         char numkey[MAX_INTEGER_DIG];
-        snprintf(numkey, MAX_INTEGER_DIG-1, "%zu", item->comp->num_branch);
+        utils->key_len = snprintf(numkey, MAX_INTEGER_DIG-1, "%zu", item->comp->num_branch);
 
         ASSERT_S(NULL == utils->key, jscon_strerror(JSCON_INT__NOT_FREED, utils->key));
-        utils->key = strdup(numkey);
+        utils->key = Jscon_strndup(numkey, sizeof(numkey));
         ASSERT_S(NULL != utils->key, jscon_strerror(JSCON_EXT__OUT_MEM, utils->key));
+        utils->key_hash = hashtable_genhash(utils->key, utils->key_len);
 
         return _jscon_branch_build(item, utils);
      }
@@ -393,7 +676,7 @@ _jscon_object_build(jscon_item_t *item, struct _jscon_utils_s *utils)
     /* fall through */
     case '\"':/*KEY STRING DETECTED*/
         ASSERT_S(NULL == utils->key, jscon_strerror(JSCON_INT__NOT_FREED, utils->key));
-        utils->key = Jscon_decode_string(&utils->buffer);
+        utils->key = Jscon_decode_key(&utils->buffer, &utils->key_len, &utils->key_hash);
         ASSERT_S(':' == *utils->buffer, jscon_strerror(JSCON_EXT__INVALID_TOKEN, utils->buffer));
         ++utils->buffer; /* skips ':' */
         CONSUME_BLANK_CHARS(utils->buffer);
@@ -438,9 +721,9 @@ _jscon_entity_build(jscon_item_t *item, struct _jscon_utils_s *utils)
 
         _jscon_value_set_null(item, utils);
         break;
-    case '-': case '1': case '2': case '3': 
-    case '4': case '5': case '6': case '7': 
-    case '8': case '9':
+    case '-': case '0': case '1': case '2':
+    case '3': case '4': case '5': case '6':
+    case '7': case '8': case '9':
         _jscon_value_set_number(item, utils);
         break;
     default:
@@ -473,39 +756,1020 @@ jscon_parse_cb(jscon_cb *new_cb)
     return parse_cb;
 }
 
-/* parse contents from buffer into a jscon item object
-    and return its root */
+/* parse the next unit (a value, a key-value pair or a composite
+    wrapper) into item, return the item that should receive the
+    following unit, or NULL if the root has been completed */
+static jscon_item_t*
+_jscon_parse_unit(jscon_item_t *item, struct _jscon_utils_s *utils)
+{
+    switch(item->type){
+    case JSCON_OBJECT:
+        return _jscon_object_build(item, utils);
+    case JSCON_ARRAY:
+        return _jscon_array_build(item, utils);
+    case JSCON_UNDEFINED: /* this should be true only at the first iteration */
+        item = _jscon_entity_build(item, utils);
+
+        if (IS_PRIMITIVE(item) || IS_PACKED(item)) return NULL;
+
+        return item;
+    default:
+        ERROR("Unknown item->type found\n\tCode: %d", item->type);
+    }
+}
+
+/* parse contents from buffer within the options' memory block and
+    resource limits, if either is exceeded then the partial tree is
+    released, NULL is returned and opt->errcode is set */
+static jscon_item_t*
+_jscon_parse_bounded(char *buffer, jscon_parse_opt_t *opt)
+{
+    jscon_alloc_t alloc = {
+        .mem = opt->mem,
+        .mem_size = opt->mem_size,
+        .max_string_len = opt->limits.max_string_len,
+    };
+
+    struct _jscon_utils_s utils = {
+        .buffer = buffer,
+        .origin = buffer,
+        .parse_cb = jscon_parse_cb(NULL),
+        .flags = opt->flags,
+        .limits = opt->limits,
+        .num_node = 1, /* root */
+    };
+    if (NULL != alloc.mem){
+        /* shapes are shared by reference counting, and packed
+            arrays are expanded on demand, both need the heap */
+        utils.flags &= ~(JSCON_PARSE_SHARE_SHAPES|JSCON_PARSE_PACK_ARRAYS);
+    }
+
+    jscon_item_t *volatile root = NULL;
+
+    jscon_alloc_t *prev_alloc = Jscon_alloc_swap(&alloc);
+    if (0 != setjmp(alloc.jmp)){
+        Jscon_alloc_swap(prev_alloc);
+
+        /* memory block trees are released along with the block */
+        if (NULL == alloc.mem){
+            free(utils.key);
+            if (NULL != root) _jscon_destroy_preorder(root);
+        }
+
+        opt->errcode = alloc.errcode;
+        return NULL;
+    }
+
+    root = Jscon_calloc(1, sizeof *root);
+    if (NULL == root){
+        Jscon_alloc_swap(prev_alloc);
+        opt->errcode = JSCON_PARSE_ERR_MEM;
+        return NULL;
+    }
+    if (NULL != alloc.mem){
+        root->flags |= JSCON_ITEM_ARENA;
+    }
+    root->flags |= (unsigned int)utils.flags << JSCON_ITEM_PARSE_SHIFT;
+
+    jscon_item_t *item = root;
+    while ((NULL != item) && ('\0' != *utils.buffer)){
+        item = _jscon_parse_unit(item, &utils);
+        /* checked in between units, when the tree is consistent */
+        _jscon_check_limit(alloc.mem_used, utils.limits.max_bytes, JSCON_PARSE_ERR_BYTES);
+    }
+
+    Jscon_alloc_swap(prev_alloc);
+    opt->errcode = JSCON_PARSE_OK;
+
+    return root;
+}
+
+/* parse contents from buffer into a jscon item object, according
+    to given options (NULL for defaults), and return its root */
 jscon_item_t*
-jscon_parse(char *buffer)
+jscon_parse_ex(char *buffer, jscon_parse_opt_t *opt)
 {
+    if (NULL != opt){
+        const jscon_parse_limits_t *limits = &opt->limits;
+        if (NULL != opt->mem
+            || limits->max_depth || limits->max_nodes
+            || limits->max_bytes || limits->max_string_len)
+        {
+            return _jscon_parse_bounded(buffer, opt);
+        }
+    }
+
     jscon_item_t *root = calloc(1, sizeof *root);
-    if (NULL == root) return NULL;
+    if (NULL == root){
+        if (NULL != opt) opt->errcode = JSCON_PARSE_ERR_MEM;
+        return NULL;
+    }
 
     struct _jscon_utils_s utils = {
         .buffer = buffer,
+        .origin = buffer,
         .parse_cb = jscon_parse_cb(NULL),
+        .flags = (NULL != opt) ? opt->flags : JSCON_PARSE_DEFAULT,
     };
+    root->flags |= (unsigned int)utils.flags << JSCON_ITEM_PARSE_SHIFT;
     
     /* build while item and buffer aren't nulled */
     jscon_item_t *item = root;
     while ((NULL != item) && ('\0' != *utils.buffer)){
-        switch(item->type){
-        case JSCON_OBJECT:
-            item = _jscon_object_build(item, &utils);
+        item = _jscon_parse_unit(item, &utils);
+    }
+
+    if (NULL != opt) opt->errcode = JSCON_PARSE_OK;
+
+    return root;
+}
+
+/* upper bound of the memory block size needed by jscon_parse_ex() for
+    a json text with max_nodes values, whose strings (keys included)
+    sum up to max_string_bytes */
+size_t
+jscon_mem_size(size_t max_nodes, size_t max_string_bytes)
+{
+    const size_t align = _Alignof(max_align_t);
+#define ALIGNED(size) (((size) + align - 1) & ~(align - 1))
+
+    /* every node may be a composite, its the worst case */
+    size_t node_size = ALIGNED(sizeof(jscon_item_t))
+                        + ALIGNED(sizeof(jscon_composite_t))
+                        + ALIGNED(sizeof(hashtable_t))
+                        + ALIGNED(2 * sizeof(jscon_item_t*))
+                        + ALIGNED(4 * (sizeof(hashtable_entry_t) + 1) + HASHTABLE_GROUP)
+                        + ALIGNED(sizeof(jscon_lazynum_t) + MAX_INTEGER_DIG)
+                        + ALIGNED(MAX_INTEGER_DIG); /* numerical key */
+
+    /* branch vectors growth: 1+2+4+..+n < 2n, for each of its copies */
+    size_t branch_size = 4 * max_nodes * sizeof(jscon_item_t*);
+    /* tables are allocated once, at most 16/7 slots per branch */
+    size_t table_size = 3 * max_nodes * (sizeof(hashtable_entry_t) + 1);
+
+#undef ALIGNED
+
+    return max_nodes * node_size
+            + branch_size + table_size
+            + max_string_bytes + max_nodes * align;
+}
+
+/* parse contents from buffer into a jscon item object
+    and return its root */
+jscon_item_t*
+jscon_parse(char *buffer){
+    return jscon_parse_ex(buffer, NULL);
+}
+
+/* resumable parsing context, the composite stack is kept
+    by the item being built (through its parent chain) */
+struct jscon_parser_s {
+    struct _jscon_utils_s utils;
+    jscon_item_t *root; /* NULL if a limit has been exceeded */
+    jscon_item_t *item; /* item to receive the next unit, NULL if done */
+
+    /* resource limits are checked within an allocation context, that
+        is only active while a step runs (check _jscon_parser_step()) */
+    bool is_bounded;
+    jscon_alloc_t alloc;
+    int errcode; /* check enum jscon_parse_errcode */
+};
+
+/* amount of units parsed between clock readings */
+#define JSCON_STEP_CLOCK_UNITS 64
+
+/* create a context for parsing buffer in steps, the buffer
+    must remain valid until jscon_parser_finish() is called */
+jscon_parser_t*
+jscon_parser_init(char *buffer, const jscon_parse_opt_t *opt)
+{
+    /* the tree would be left inside the block in between steps */
+    ASSERT_S(NULL == opt || NULL == opt->mem, "Can't parse into a memory block in steps (use jscon_parse_ex())");
+
+    jscon_parser_t *new_parser = calloc(1, sizeof *new_parser);
+    if (NULL == new_parser) return NULL;
+
+    new_parser->root = calloc(1, sizeof *new_parser->root);
+    if (NULL == new_parser->root){
+        free(new_parser);
+        return NULL;
+    }
+
+    new_parser->utils = (struct _jscon_utils_s){
+        .buffer = buffer,
+        .origin = buffer,
+        .parse_cb = jscon_parse_cb(NULL),
+        .flags = (NULL != opt) ? opt->flags : JSCON_PARSE_DEFAULT,
+        /* prescanning could cost a full pass over the buffer in a single step */
+        .no_prescan = true,
+    };
+    new_parser->root->flags |= (unsigned int)new_parser->utils.flags << JSCON_ITEM_PARSE_SHIFT;
+    new_parser->item = new_parser->root;
+
+    if (NULL != opt){
+        const jscon_parse_limits_t *limits = &opt->limits;
+        new_parser->is_bounded = limits->max_depth || limits->max_nodes
+                                    || limits->max_bytes || limits->max_string_len;
+    }
+    if (new_parser->is_bounded){
+        new_parser->utils.limits = opt->limits;
+        new_parser->utils.num_node = 1; /* root */
+
+        new_parser->alloc.mem_used = sizeof *new_parser->root;
+        new_parser->alloc.max_string_len = opt->limits.max_string_len;
+    }
+
+    return new_parser;
+}
+
+static bool
+_jscon_parser_is_done(jscon_parser_t *parser){
+    return (NULL == parser->item) || ('\0' == *parser->utils.buffer);
+}
+
+static long long
+_jscon_clock_ns()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (long long)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+/* parse units until at least max_bytes of buffer have been consumed,
+    or max_ns nanoseconds have elapsed (if max_ns isn't negative). if
+    a resource limit is exceeded the partial tree is released, and
+    every step from then on fails */
+static enum jscon_parse_status
+_jscon_parser_step(jscon_parser_t *parser, size_t max_bytes, long long max_ns)
+{
+    if (JSCON_PARSE_OK != parser->errcode) return JSCON_PARSE_ERROR;
+
+    jscon_alloc_t *prev_alloc = NULL;
+    if (parser->is_bounded){
+        prev_alloc = Jscon_alloc_swap(&parser->alloc);
+        if (0 != setjmp(parser->alloc.jmp)){
+            Jscon_alloc_swap(prev_alloc);
+
+            free(parser->utils.key);
+            parser->utils.key = NULL;
+            _jscon_destroy_preorder(parser->root);
+            parser->root = parser->item = NULL;
+
+            parser->errcode = parser->alloc.errcode;
+            return JSCON_PARSE_ERROR;
+        }
+    }
+
+    enum jscon_parse_status status = JSCON_PARSE_DONE;
+
+    char *start = parser->utils.buffer;
+    long long deadline = (max_ns < 0) ? 0 : _jscon_clock_ns() + max_ns;
+    size_t num_unit = 0;
+    while (!_jscon_parser_is_done(parser)){
+        if ((size_t)(parser->utils.buffer - start) >= max_bytes){
+            status = JSCON_PARSE_MORE;
             break;
-        case JSCON_ARRAY:
-            item = _jscon_array_build(item, &utils);
+        }
+        if ((max_ns >= 0)
+            && (0 == ++num_unit % JSCON_STEP_CLOCK_UNITS)
+            && (_jscon_clock_ns() >= deadline))
+        {
+            status = JSCON_PARSE_MORE;
             break;
-        case JSCON_UNDEFINED: /* this should be true only at the first iteration */
-            item = _jscon_entity_build(item, &utils);
+        }
+
+        parser->item = _jscon_parse_unit(parser->item, &parser->utils);
+        if (parser->is_bounded){
+            /* checked in between units, when the tree is consistent */
+            _jscon_check_limit(parser->alloc.mem_used, parser->utils.limits.max_bytes, JSCON_PARSE_ERR_BYTES);
+        }
+    }
+
+    if (parser->is_bounded){
+        Jscon_alloc_swap(prev_alloc);
+    }
+
+    return status;
+}
+
+/* parse units until at least max_bytes of buffer have been consumed */
+enum jscon_parse_status
+jscon_parse_step(jscon_parser_t *parser, size_t max_bytes){
+    return _jscon_parser_step(parser, max_bytes, -1);
+}
+
+/* parse units until at least max_ns nanoseconds have elapsed */
+enum jscon_parse_status
+jscon_parse_step_ns(jscon_parser_t *parser, long long max_ns){
+    return _jscon_parser_step(parser, (size_t)-1, max_ns);
+}
 
-            if (IS_PRIMITIVE(item)) return item;
+/* why the parse failed, once a step has returned JSCON_PARSE_ERROR
+    (JSCON_PARSE_OK otherwise) */
+int
+jscon_parser_errcode(const jscon_parser_t *parser){
+    return parser->errcode;
+}
+
+/* parse whatever is left of the buffer, free the context
+    and return the root (NULL if a resource limit was exceeded) */
+jscon_item_t*
+jscon_parser_finish(jscon_parser_t *parser)
+{
+    jscon_parse_step(parser, (size_t)-1);
+
+    jscon_item_t *root = parser->root;
+    free(parser);
+
+    return root;
+}
 
+/* skips string tokens (starting at its double quotes) within bounds,
+    return NULL if the string isn't terminated before end */
+static char*
+_jscon_span_string(char *buffer, char *end)
+{
+    ++buffer; /* skips opening double quotes */
+    while (buffer < end){
+        switch (*buffer++){
+        case '\\': /* skips escaped characters */
+            if (buffer == end) return NULL;
+            ++buffer;
             break;
+        case '\"':
+            return buffer;
         default:
-            ERROR("Unknown item->type found\n\tCode: %d", item->type);
+            break;
+        }
+    }
+    return NULL;
+}
+
+/* skips a value's first token within bounds (only the opening delim
+    of a composite), return NULL if it isn't entirely contained */
+static char*
+_jscon_span_value(char *buffer, char *end)
+{
+    switch (*buffer){
+    case '{': case '[':
+        return buffer + 1;
+    case '\"':
+        return _jscon_span_string(buffer, end);
+    case 't': case 'n':
+        return (end - buffer >= 4) ? buffer + 4 : NULL;
+    case 'f':
+        return (end - buffer >= 5) ? buffer + 5 : NULL;
+    case '-': case '0': case '1': case '2': 
+    case '3': case '4': case '5': case '6': 
+    case '7': case '8': case '9':
+        /* a number is only complete once a non-number char is found */
+        while (buffer < end && (isdigit(*buffer) || strchr("+-.eE", *buffer))){
+            ++buffer;
+        }
+        return (buffer < end) ? buffer : NULL;
+    default: /* invalid token, parser will complain about it */
+        return buffer;
+    }
+}
+
+/* check if [buffer,end) contains the whole unit to be parsed by
+    _jscon_parse_unit(), so that it won't read past end */
+static bool
+_jscon_span_unit(jscon_item_t *item, char *buffer, char *end)
+{
+    while (buffer < end && IS_BLANK_CHAR(*buffer)) ++buffer;
+    if (buffer == end) return false;
+
+    switch (item->type){
+    case JSCON_OBJECT:
+        if ('}' == *buffer) return true;
+        if (',' == *buffer){
+            ++buffer; /* skips ',' */
+            while (buffer < end && IS_BLANK_CHAR(*buffer)) ++buffer;
+            if (buffer == end) return false;
         }
+        if ('\"' != *buffer) return true; /* parser will complain about it */
+
+        buffer = _jscon_span_string(buffer, end);
+        if (NULL == buffer || buffer == end) return false;
+        if (':' != *buffer) return true; /* parser will complain about it */
+
+        ++buffer; /* skips ':' */
+        while (buffer < end && IS_BLANK_CHAR(*buffer)) ++buffer;
+        if (buffer == end) return false;
+
+        return NULL != _jscon_span_value(buffer, end);
+    case JSCON_ARRAY:
+        if (']' == *buffer) return true;
+        if (',' == *buffer){
+            ++buffer; /* skips ',' */
+            while (buffer < end && IS_BLANK_CHAR(*buffer)) ++buffer;
+            if (buffer == end) return false;
+        }
+        return NULL != _jscon_span_value(buffer, end);
+    default:
+        return NULL != _jscon_span_value(buffer, end);
+    }
+}
+
+/* buffer for a unit that straddles segments
+    (its content is nul-terminated once the unit is complete) */
+struct _jscon_carry_s {
+    char *buffer;
+    size_t len;
+    size_t size;
+};
+
+static void
+_jscon_carry_append(struct _jscon_carry_s *carry, const char *src, size_t len)
+{
+    if (carry->len + len + 1 > carry->size){
+        carry->size = 2 * (carry->len + len + 1);
+
+        char *tmp = realloc(carry->buffer, carry->size);
+        ASSERT_S(NULL != tmp, jscon_strerror(JSCON_EXT__OUT_MEM, tmp));
+        carry->buffer = tmp;
+    }
+    memcpy(carry->buffer + carry->len, src, len);
+    carry->len += len;
+}
+
+/* parse contents from a chain of (not nul-terminated) buffers into
+    a jscon item object and return its root. units are parsed straight
+    from their segment, only the ones that straddle a segment boundary
+    are gathered in a small carry buffer */
+jscon_item_t*
+jscon_parse_iov(const struct iovec *iov, int iovcnt)
+{
+    jscon_item_t *root = calloc(1, sizeof *root);
+    if (NULL == root) return NULL;
+
+    struct _jscon_utils_s utils = {
+        .parse_cb = jscon_parse_cb(NULL),
+        .flags = JSCON_PARSE_DEFAULT,
+        .no_prescan = true,
+    };
+
+    struct _jscon_carry_s carry = {0};
+
+    /* current segment and offset within it */
+    int seg = 0;
+    size_t offset = 0;
+
+    jscon_item_t *item = root;
+    while ((NULL != item) && (seg < iovcnt)){
+        char *base = iov[seg].iov_base;
+        if (offset == iov[seg].iov_len){
+            ++seg;
+            offset = 0;
+            continue;
+        }
+
+        /* 1st STEP: whole unit is contained in segment, parse in place */
+        if (_jscon_span_unit(item, base + offset, base + iov[seg].iov_len)){
+            utils.buffer = base + offset;
+            item = _jscon_parse_unit(item, &utils);
+            offset = utils.buffer - base;
+            continue;
+        }
+
+        /* 2nd STEP: gather unit in the carry buffer, growing the amount
+            of bytes fetched from the next segments geometrically */
+        carry.len = 0;
+        _jscon_carry_append(&carry, base + offset, iov[seg].iov_len - offset);
+
+        int next_seg = seg + 1;
+        size_t next_offset = 0;
+        while ((next_seg < iovcnt)
+                && !_jscon_span_unit(item, carry.buffer, carry.buffer + carry.len))
+        {
+            size_t len = iov[next_seg].iov_len - next_offset;
+            if (len > carry.len + 64){
+                len = carry.len + 64;
+            }
+            _jscon_carry_append(&carry, (char*)iov[next_seg].iov_base + next_offset, len);
+
+            next_offset += len;
+            if (next_offset == iov[next_seg].iov_len){
+                ++next_seg;
+                next_offset = 0;
+            }
+        }
+        carry.buffer[carry.len] = '\0'; /* input end (if unit incomplete) */
+
+        char *tail = carry.buffer;
+        CONSUME_BLANK_CHARS(tail);
+        if ('\0' == *tail) break; /* nothing left but blank chars */
+
+        /* 3rd STEP: parse unit from the carry buffer, and then map the
+            amount consumed back to a segment position */
+        utils.buffer = carry.buffer;
+        item = _jscon_parse_unit(item, &utils);
+
+        size_t consumed = offset + (utils.buffer - carry.buffer);
+        while ((seg < iovcnt) && (consumed >= iov[seg].iov_len)){
+            consumed -= iov[seg].iov_len;
+            ++seg;
+        }
+        offset = consumed;
+    }
+
+    free(carry.buffer);
+
+    return root;
+}
+
+/* move src's value into dest (whose old value is freed), dest keeps
+    its key, place in the tree and parse flags (if root). src must be
+    a root, and is freed */
+static void
+_jscon_item_transplant(jscon_item_t *dest, jscon_item_t *src)
+{
+    _jscon_destroy_value(dest);
+
+    char *key = dest->key;
+    size_t key_len = dest->key_len;
+    uint64_t key_hash = dest->key_hash;
+    jscon_item_t *parent = dest->parent;
+    size_t index = dest->index;
+    unsigned int kept_flags = dest->flags & (JSCON_ITEM_SHARED_KEY|JSCON_ITEM_PARSE_MASK);
+
+    *dest = *src;
+    dest->key = key;
+    dest->key_len = key_len;
+    dest->key_hash = key_hash;
+    dest->parent = parent;
+    dest->index = index;
+    dest->flags = (dest->flags & ~JSCON_ITEM_PARSE_MASK) | kept_flags;
+
+    free(src);
+
+    if (!IS_COMPOSITE(dest)) return;
+
+    for (size_t i=0; i < dest->comp->num_branch; ++i){
+        dest->comp->branch[i]->parent = dest;
+    }
+}
+
+/* parse buffer's first value into a new root, with source spans
+    relative to buffer, and the parse flags of the tree it's meant
+    for. p_end (may be NULL) is set past the value */
+static jscon_item_t*
+_jscon_parse_span(char *buffer, char **p_end, int flags)
+{
+    jscon_item_t *root = _jscon_item_init();
+
+    struct _jscon_utils_s utils = {
+        .buffer = buffer,
+        .origin = buffer,
+        .parse_cb = jscon_parse_cb(NULL),
+        .flags = flags,
+    };
+
+    jscon_item_t *item = root;
+    while ((NULL != item) && ('\0' != *utils.buffer)){
+        item = _jscon_parse_unit(item, &utils);
+    }
+
+    if (NULL != p_end){
+        *p_end = utils.buffer;
+    }
+
+    return root;
+}
+
+/* whether the composite's span (starting at start) strictly encloses the
+    edit, so that its delimiters are left untouched */
+static bool
+_jscon_span_encloses(jscon_item_t *item, size_t start, size_t edit_offset, size_t old_len)
+{
+    jscon_composite_t *comp = item->comp;
+    if (0 == comp->src_len) return false;
+
+    return (start < edit_offset) && (edit_offset + old_len < start + comp->src_len);
+}
+
+/* update the tree parsed from buffer after its text at [edit_offset,
+    edit_offset+old_len) has been replaced by new_len bytes. only the
+    smallest composite enclosing the edit is re-parsed and spliced in,
+    the whole buffer is re-parsed into root if no such composite is
+    found. return the re-parsed item */
+jscon_item_t*
+jscon_reparse(jscon_item_t *root, char *buffer, size_t edit_offset, size_t old_len, size_t new_len)
+{
+    ASSERT_S(IS_ROOT(root), "Item is not root");
+    ASSERT_S(!IS_READ_ONLY(root), "Can't modify a read-only tree");
+
+    jscon_item_t *item = NULL;
+    size_t start = 0;
+    if (IS_COMPOSITE(root)){
+        start = root->comp->src_offset;
+        if (_jscon_span_encloses(root, start, edit_offset, old_len)){
+            item = root;
+        }
+    }
+
+    /* descend into the smallest enclosing composite */
+    jscon_item_t *parent = item;
+    while (NULL != parent && NULL == parent->comp->packed){
+        Jscon_composite_compact(parent);
+
+        jscon_composite_t *comp = parent->comp;
+        parent = NULL;
+        for (size_t i=0; i < comp->num_branch; ++i){
+            jscon_item_t *branch = comp->branch[i];
+            if (!IS_COMPOSITE(branch)) continue;
+
+            size_t branch_start = start + branch->comp->src_offset;
+            if (_jscon_span_encloses(branch, branch_start, edit_offset, old_len)){
+                item = parent = branch;
+                start = branch_start;
+                break;
+            }
+        }
+    }
+
+    if (NULL != item){
+        jscon_item_t *new_item = _jscon_parse_span(buffer + start, NULL, ROOT_PARSE_FLAGS(root));
+
+        /* if the edit breaks the composite's boundaries, its new span
+            won't match, and the whole buffer has to be re-parsed */
+        if (new_item->type == item->type
+            && new_item->comp->src_len + old_len == item->comp->src_len + new_len)
+        {
+            size_t src_offset = item->comp->src_offset;
+            _jscon_item_transplant(item, new_item);
+            item->comp->src_offset = src_offset;
+
+            /* shift spans that come after the edit */
+            ptrdiff_t delta = (ptrdiff_t)new_len - (ptrdiff_t)old_len;
+            jscon_item_t *child = item;
+            while (!IS_ROOT(child)){
+                jscon_composite_t *comp = child->parent->comp;
+
+                size_t i = child->index;
+                while (++i < comp->num_branch){
+                    if (IS_COMPOSITE(comp->branch[i])){
+                        comp->branch[i]->comp->src_offset += delta;
+                    }
+                }
+                comp->src_len += delta;
+
+                child = child->parent;
+            }
+
+            return item;
+        }
+
+        _jscon_destroy_preorder(new_item);
     }
 
+    jscon_item_t *new_root = _jscon_parse_span(buffer, NULL, ROOT_PARSE_FLAGS(root));
+    _jscon_item_transplant(root, new_root);
+
     return root;
 }
+
+/* jscon_parse_update() state */
+struct _jscon_update_s {
+    char *buffer;
+    int flags; /* root's parse flags, for structural edits */
+    jscon_cb *changed_cb; /* called for every changed item (may be NULL) */
+    size_t num_changed;
+};
+
+/* changed items are flagged, and only reported once the whole buffer
+    has been parsed (check _jscon_update_report()), as a composite that
+    turns out not to match replaces (and frees) the branches it updated
+    so far */
+static void
+_jscon_update_changed(jscon_item_t *item, struct _jscon_update_s *update)
+{
+    if (NULL != update->changed_cb){
+        item->flags |= JSCON_ITEM_CHANGED;
+    }
+    ++update->num_changed;
+}
+
+/* report flagged items in preorder, a flagged composite has been
+    replaced (or is packed), so its branches are left as is */
+static void
+_jscon_update_report(jscon_item_t *item, jscon_cb *changed_cb)
+{
+    if (item->flags & JSCON_ITEM_CHANGED){
+        item->flags &= ~JSCON_ITEM_CHANGED;
+        (*changed_cb)(item);
+        return;
+    }
+
+    if (!IS_COMPOSITE(item)) return;
+
+    for (size_t i=0; i < item->comp->num_branch; ++i){
+        if (NULL != item->comp->branch[i]){
+            _jscon_update_report(item->comp->branch[i], changed_cb);
+        }
+    }
+}
+
+/* skips string token (starting at its double quotes) */
+static char*
+_jscon_skip_string(char *buffer)
+{
+    ASSERT_S('\"' == *buffer, jscon_strerror(JSCON_EXT__INVALID_STRING, buffer));
+
+    ++buffer; /* skips opening double quotes */
+    while ('\"' != *buffer){
+        ASSERT_S('\0' != *buffer, jscon_strerror(JSCON_EXT__INVALID_STRING, buffer));
+        if ('\\' == *buffer++){ /* skips escaped characters */
+            ++buffer;
+        }
+    }
+    return buffer + 1; /* skips closing double quotes */
+}
+
+static void _jscon_update_value(jscon_item_t *item, struct _jscon_update_s *update, char *parent_start);
+
+static bool
+_jscon_update_object(jscon_item_t *item, struct _jscon_update_s *update, char *start)
+{
+    Jscon_composite_expand(item);
+    Jscon_composite_compact(item);
+
+    jscon_composite_t *comp = item->comp;
+
+    ++update->buffer; /* skips '{' */
+    for (size_t i=0; ; ++i){
+        CONSUME_BLANK_CHARS(update->buffer);
+        if ('}' == *update->buffer){
+            ++update->buffer; /* skips '}' */
+            return i == comp->num_branch;
+        }
+        if (i > 0){
+            if (',' != *update->buffer) return false;
+
+            ++update->buffer; /* skips ',' */
+            CONSUME_BLANK_CHARS(update->buffer);
+        }
+        if (i == comp->num_branch) return false;
+
+        /* compare keys as is, without decoding them */
+        char *key = update->buffer + 1; /* skips opening double quotes */
+        update->buffer = _jscon_skip_string(update->buffer);
+
+        size_t key_len = update->buffer - key - 1;
+        char *branch_key = comp->branch[i]->key;
+        if (!STRNEQ(branch_key, key, key_len) || '\0' != branch_key[key_len])
+            return false;
+
+        if (':' != *update->buffer) return false;
+        ++update->buffer; /* skips ':' */
+
+        _jscon_update_value(comp->branch[i], update, start);
+    }
+}
+
+static bool
+_jscon_update_array(jscon_item_t *item, struct _jscon_update_s *update, char *start)
+{
+    Jscon_composite_expand(item);
+    Jscon_composite_compact(item);
+
+    jscon_composite_t *comp = item->comp;
+
+    ++update->buffer; /* skips '[' */
+    for (size_t i=0; ; ++i){
+        CONSUME_BLANK_CHARS(update->buffer);
+        if (']' == *update->buffer){
+            ++update->buffer; /* skips ']' */
+            return i == comp->num_branch;
+        }
+        if (i > 0){
+            if (',' != *update->buffer) return false;
+
+            ++update->buffer; /* skips ',' */
+        }
+        if (i == comp->num_branch) return false;
+
+        _jscon_update_value(comp->branch[i], update, start);
+    }
+}
+
+/* overwrite packed array's vector, if the new elements fit in it */
+static bool
+_jscon_update_packed(jscon_item_t *item, struct _jscon_update_s *update)
+{
+    jscon_packed_t *packed = item->comp->packed;
+    bool is_changed = false;
+
+    ++update->buffer; /* skips '[' */
+    for (size_t i=0; ; ++i){
+        CONSUME_BLANK_CHARS(update->buffer);
+        if (']' == *update->buffer){
+            ++update->buffer; /* skips ']' */
+            if (i != packed->len) return false;
+            break;
+        }
+        if (i > 0){
+            if (',' != *update->buffer) return false;
+
+            ++update->buffer; /* skips ',' */
+            CONSUME_BLANK_CHARS(update->buffer);
+        }
+        if (i == packed->len) return false;
+
+        if (JSCON_BOOLEAN == packed->type){
+            if ('t' != *update->buffer && 'f' != *update->buffer) return false;
+
+            bool boolean = Jscon_decode_boolean(&update->buffer);
+            is_changed = is_changed || (boolean != packed->boolean[i]);
+            packed->boolean[i] = boolean;
+            continue;
+        }
+
+        if ('-' != *update->buffer && !isdigit(*update->buffer)) return false;
+
+        char *end = Jscon_skip_number(update->buffer);
+        double d_number = strtod(update->buffer, NULL);
+        update->buffer = end;
+
+        if (JSCON_INTEGER == packed->type){
+            if (!DOUBLE_IS_INTEGER(d_number)) return false;
+
+            is_changed = is_changed || ((long long)d_number != packed->i_number[i]);
+            packed->i_number[i] = (long long)d_number;
+        } else {
+            is_changed = is_changed || (d_number != packed->d_number[i]);
+            packed->d_number[i] = d_number;
+        }
+    }
+
+    if (is_changed){
+        _jscon_update_changed(item, update);
+    }
+    return true;
+}
+
+static void
+_jscon_update_string(jscon_item_t *item, struct _jscon_update_s *update)
+{
+    char *str = update->buffer + 1; /* skips opening double quotes */
+    update->buffer = _jscon_skip_string(update->buffer);
+
+    size_t len = update->buffer - str - 1;
+    size_t old_len = strlen(item->string);
+    if (len == old_len && STRNEQ(item->string, str, len)) return;
+
+    /* only grows if new string doesn't fit */
+    if (len > old_len){
+        char *tmp = realloc(item->string, len + 1);
+        ASSERT_S(NULL != tmp, jscon_strerror(JSCON_EXT__OUT_MEM, tmp));
+        item->string = tmp;
+    }
+    memcpy(item->string, str, len);
+    item->string[len] = '\0';
+
+    _jscon_update_changed(item, update);
+}
+
+static void
+_jscon_update_number(jscon_item_t *item, struct _jscon_update_s *update)
+{
+    if (IS_LAZY_NUMBER(item)){
+        char *end = Jscon_skip_number(update->buffer);
+
+        size_t len = end - update->buffer;
+        size_t old_len = strlen(item->lazynum->text);
+        if (len == old_len && STRNEQ(item->lazynum->text, update->buffer, len)){
+            update->buffer = end;
+            return;
+        }
+
+        bool is_integer;
+        if (len > old_len){ /* doesn't fit, get a new one */
+            free(item->lazynum);
+            item->lazynum = Jscon_decode_lazynum(&update->buffer, &is_integer);
+        } else {
+            memcpy(item->lazynum->text, update->buffer, len);
+            item->lazynum->text[len] = '\0';
+            item->lazynum->is_cached = false;
+            is_integer = (NULL == strpbrk(item->lazynum->text, ".eE"));
+            update->buffer = end;
+        }
+        item->type = is_integer ? JSCON_INTEGER : JSCON_DOUBLE;
+
+        _jscon_update_changed(item, update);
+        return;
+    }
+
+    double set_double = Jscon_decode_double(&update->buffer);
+    if (DOUBLE_IS_INTEGER(set_double)){
+        if (JSCON_INTEGER == item->type && item->i_number == (long long)set_double) return;
+
+        item->type = JSCON_INTEGER;
+        item->i_number = (long long)set_double;
+    } else {
+        if (JSCON_DOUBLE == item->type && item->d_number == set_double) return;
+
+        item->type = JSCON_DOUBLE;
+        item->d_number = set_double;
+    }
+
+    _jscon_update_changed(item, update);
+}
+
+/* update item with the value at buffer, in place if it's of the same
+    type (and composites have the same keys), otherwise by replacing it
+    with a freshly parsed one */
+static void
+_jscon_update_value(jscon_item_t *item, struct _jscon_update_s *update, char *parent_start)
+{
+    CONSUME_BLANK_CHARS(update->buffer);
+
+    char *start = update->buffer;
+    size_t num_changed = update->num_changed;
+    bool is_in_place = false;
+    switch (*start){
+    case '{':
+        if (JSCON_OBJECT == item->type){
+            is_in_place = _jscon_update_object(item, update, start);
+        }
+        break;
+    case '[':
+        if (IS_PACKED(item)){
+            is_in_place = _jscon_update_packed(item, update);
+        }
+        else if (JSCON_ARRAY == item->type){
+            is_in_place = _jscon_update_array(item, update, start);
+        }
+        break;
+    case '\"':
+        if (JSCON_STRING == item->type){
+            _jscon_update_string(item, update);
+            is_in_place = true;
+        }
+        break;
+    case 't': case 'f':
+        if (JSCON_BOOLEAN == item->type){
+            bool boolean = Jscon_decode_boolean(&update->buffer);
+            if (boolean != item->boolean){
+                item->boolean = boolean;
+                _jscon_update_changed(item, update);
+            }
+            is_in_place = true;
+        }
+        break;
+    case 'n':
+        if (JSCON_NULL == item->type){
+            Jscon_decode_null(&update->buffer);
+            is_in_place = true;
+        }
+        break;
+    default:
+        if (jscon_typecmp(item, JSCON_NUMBER)){
+            _jscon_update_number(item, update);
+            is_in_place = true;
+        }
+        break;
+    }
+
+    if (!is_in_place){ /* fall back to a structural edit */
+        /* its updated branches are about to be freed, it's reported instead */
+        update->num_changed = num_changed;
+
+        jscon_item_t *new_item = _jscon_parse_span(start, &update->buffer, update->flags);
+        _jscon_item_transplant(item, new_item);
+
+        _jscon_update_changed(item, update);
+    }
+
+    if (IS_COMPOSITE(item)){
+        item->comp->src_offset = start - parent_start;
+        item->comp->src_len = update->buffer - start;
+    }
+}
+
+/* parse buffer into an existing tree, values of items that match the
+    buffer's keys and datatypes are overwritten in place, mismatching
+    items are replaced. changed_cb (may be NULL) is called for every
+    item whose value changed once the buffer has been parsed, and the
+    amount of them is returned */
+size_t
+jscon_parse_update(jscon_item_t *root, char *buffer, jscon_cb *changed_cb)
+{
+    ASSERT_S(IS_ROOT(root), "Item is not root");
+    ASSERT_S(!IS_READ_ONLY(root), "Can't modify a read-only tree");
+
+    struct _jscon_update_s update = {
+        .buffer = buffer,
+        .flags = ROOT_PARSE_FLAGS(root),
+        .changed_cb = changed_cb,
+    };
+
+    _jscon_update_value(root, &update, buffer);
+
+    if (NULL != changed_cb && 0 != update.num_changed){
+        _jscon_update_report(root, changed_cb);
+    }
+
+    return update.num_changed;
+}
@@ -46,9 +46,13 @@ _jscon_new(const char *key, enum jscon_type type)
     } else {
         new_item->key = NULL;
     }
+    new_item->key_len = 0;
+    new_item->key_hash = 0; /* computed once needed */
 
     new_item->parent = NULL;
+    new_item->index = 0;
     new_item->type = type;
+    new_item->flags = 0;
 
     return new_item;
 }
@@ -133,6 +137,7 @@ _jscon_composite(const char *key, enum jscon_type type)
 
     new_item->comp->branch = malloc(sizeof(jscon_item_t*));
     if (NULL == new_item->comp->branch) goto cleanupC;
+    new_item->comp->max_branch = 1;
 
     Jscon_composite_build(new_item);
 
@@ -162,46 +167,20 @@ jscon_array(const char *key){
 
 /* total branches the item possess, returns 0 if item type is primitive */
 size_t
-jscon_size(const jscon_item_t *item){
-    return IS_COMPOSITE(item) ? item->comp->num_branch : 0;
-} 
-
-static size_t
-_jscon_depth(jscon_item_t *item)
-{
-    size_t depth = 0;
-    while (!IS_ROOT(item)){
-        item = item->parent;
-        ++depth;
-    }
-
-    return depth;
-}
-
-/* get the last comp relative to the item */
-static jscon_composite_t*
-_jscon_get_deepest(jscon_item_t *item)
+jscon_size(const jscon_item_t *item)
 {
-    ASSERT_S(IS_COMPOSITE(item), jscon_strerror(JSCON_EXT__NOT_COMPOSITE, item));
-
-    size_t item_depth = _jscon_depth(item);
-
-    /* get the deepest nested composite relative to item */
-    jscon_composite_t *comp_last = item->comp;
-    while(NULL != comp_last->next){
-        if (item_depth > _jscon_depth(comp_last->next->p_item)){
-            break;
-        }
-        comp_last = comp_last->next;
-    }
+    if (!IS_COMPOSITE(item)) return 0;
 
-    return comp_last;
-}
+    if (IS_PACKED(item)) return item->comp->packed->len;
+    if (NULL != item->comp->source) return jscon_size(item->comp->source);
+    return item->comp->num_branch - item->comp->num_deleted;
+} 
 
 jscon_item_t*
 jscon_append(jscon_item_t *item, jscon_item_t *new_branch)
 {
     ASSERT_S(new_branch != item, "Can't perform circular append");
+    ASSERT_S(!IS_READ_ONLY(item) && !IS_READ_ONLY(new_branch), "Can't modify a read-only tree");
 
     char *hold_key = NULL; /* hold new_branch->key incase we can't allocate memory for new numerical key */
     switch (item->type){
@@ -210,10 +189,11 @@ jscon_append(jscon_item_t *item, jscon_item_t *new_branch)
         hold_key = new_branch->key; 
 
         char numkey[MAX_INTEGER_DIG];
-        snprintf(numkey, MAX_INTEGER_DIG-1, "%zu", item->comp->num_branch);
+        snprintf(numkey, MAX_INTEGER_DIG-1, "%zu", jscon_size(item));
 
         new_branch->key = strdup(numkey);
         if (NULL == new_branch->key) goto cleanupA; /* Out of memory, reattach its old key and return NULL */
+        new_branch->key_hash = 0; /* outdated */
      }
     /* fall through */
     case JSCON_OBJECT:
@@ -222,29 +202,29 @@ jscon_append(jscon_item_t *item, jscon_item_t *new_branch)
         ERROR("Can't append to\n\t%s", jscon_strerror(JSCON_EXT__NOT_COMPOSITE, item));
     }
 
-    /* realloc parent references to match new size */
-    jscon_item_t **tmp = realloc(item->comp->branch, (1+item->comp->num_branch) * sizeof(jscon_item_t*));
-    if (NULL == tmp) goto cleanupB;
+    /* packed elements can't be mixed with items */
+    Jscon_composite_expand(item);
+    /* shared keys can't be extended, get object's own keys back */
+    Jscon_composite_unshare(item);
 
-    item->comp->branch = tmp;
+    /* reuse dettached branches slots, or grow parent references
+        geometrically, so that appends are amortized O(1) */
+    if (item->comp->num_branch == item->comp->max_branch){
+        Jscon_composite_compact(item);
+    }
+    if (item->comp->num_branch == item->comp->max_branch){
+        if (!Jscon_composite_reserve(item, 2 * item->comp->max_branch))
+            goto cleanupB;
+    }
 
     ++item->comp->num_branch;
 
     item->comp->branch[item->comp->num_branch-1] = new_branch;
     new_branch->parent = item;
+    new_branch->index = item->comp->num_branch-1;
 
-    if (item->comp->num_branch <= item->comp->hashtable->num_bucket){
-        Jscon_composite_set(new_branch->key, new_branch);
-    } else {
-        Jscon_composite_remake(item);
-    }
-
-    if (IS_COMPOSITE(new_branch)){
-        /* get the last comp relative to item */
-        jscon_composite_t *comp_last = _jscon_get_deepest(item);
-        comp_last->next = new_branch->comp;
-        new_branch->comp->prev = comp_last;
-    }
+    /* hashtable grows on demand */
+    Jscon_composite_set(new_branch->key, new_branch);
 
     if (hold_key != NULL){
         free(hold_key);
@@ -257,48 +237,115 @@ cleanupB:
         free(new_branch->key);
 cleanupA:
     new_branch->key = hold_key;
+    new_branch->key_hash = 0;
 
     return NULL;
 }
 
-/* @todo test this */
+/* make room for num_branch branches, so that appending up to that
+    amount won't reallocate, return NULL if out of memory */
 jscon_item_t*
-jscon_dettach(jscon_item_t *item)
+jscon_reserve(jscon_item_t *item, size_t num_branch)
 {
-    /* can't dettach root from nothing */
-    if (NULL == item || IS_ROOT(item)) return item;
+    ASSERT_S(IS_COMPOSITE(item), jscon_strerror(JSCON_EXT__NOT_COMPOSITE, item));
+    ASSERT_S(!IS_READ_ONLY(item), "Can't modify a read-only tree");
 
-    /* get the item index reference from its parent */
-    jscon_item_t *item_parent = item->parent;
+    /* same as jscon_append(), branches are about to be modified */
+    Jscon_composite_expand(item);
+    Jscon_composite_unshare(item);
+    Jscon_composite_compact(item);
+
+    if (!Jscon_composite_reserve(item, num_branch)) return NULL;
 
-    /* realloc parent references to match new size */
-    jscon_item_t **tmp = realloc(item_parent->comp->branch, jscon_size(item_parent) * sizeof(jscon_item_t*));
-    if (NULL == tmp) return NULL;
+    hashtable_reserve(item->comp->hashtable, num_branch);
 
-    item_parent->comp->branch = tmp;
+    return item;
+}
 
-    /* dettach the item from its parent and reorder keys */
-    for (size_t i = jscon_get_index(item_parent, item->key); i < jscon_size(item_parent)-1; ++i){
-        item_parent->comp->branch[i] = item_parent->comp->branch[i+1]; 
+static bool
+_jscon_freeze_preorder(jscon_item_t *item)
+{
+    bool is_perfect = true;
+    if (IS_COMPOSITE(item)){
+        /* composites are settled before their branches are frozen */
+        if (!Jscon_composite_freeze(item)){
+            is_perfect = false;
+        }
+        /* (shared clones branches are left at their frozen source) */
+        for (size_t i=0; i < item->comp->num_branch; ++i){
+            if (!_jscon_freeze_preorder(item->comp->branch[i])){
+                is_perfect = false;
+            }
+        }
+    } else if (IS_LAZY_NUMBER(item)){
+        /* so that reading it won't write to it */
+        Jscon_lazynum_resolve(item);
     }
-    item_parent->comp->branch[jscon_size(item_parent)-1] = NULL;
-    --item_parent->comp->num_branch;
+    item->flags |= JSCON_ITEM_FROZEN;
+
+    return is_perfect;
+}
 
-    /* parent hashtable has to be remade, to match reordered keys */
-    Jscon_composite_remake(item_parent);
+/* turn root's tree read-only, objects lookups are then made through
+    a minimal perfect hash of its keys, return false if some object
+    couldn't have one built, in which case it keeps its hashtable */
+bool
+jscon_freeze(jscon_item_t *root)
+{
+    ASSERT_S(IS_ROOT(root), "Can only freeze a tree from its root");
+    ASSERT_S(!IS_ARENA(root), "Can't freeze a tree allocated from a memory block");
 
-    /* get the immediate previous comp relative to the item */
-    jscon_composite_t *comp_prev = item->comp->prev;
-    /* get the last comp relative to item */
-    jscon_composite_t *comp_last = _jscon_get_deepest(item);
+    if (IS_FROZEN(root)) return true;
+
+    return _jscon_freeze_preorder(root);
+}
+
+/* @todo test this */
+jscon_item_t*
+jscon_dettach(jscon_item_t *item)
+{
+    /* can't dettach root from nothing */
+    if (NULL == item || IS_ROOT(item)) return item;
+
+    ASSERT_S(!IS_READ_ONLY(item), "Can't modify a read-only tree");
+
+    jscon_item_t *item_parent = item->parent;
+    jscon_composite_t *parent_comp = item_parent->comp;
+
+    /* item's key might belong to parent's shape, get it back */
+    Jscon_composite_unshare(item_parent);
+
+    /* remove item's key, unless item is a repeated key that is
+        shadowed by a previous one */
+    uint64_t hash = Jscon_key_hash(item);
+    if (item == hashtable_get_h(parent_comp->hashtable, item->key, hash)){
+        hashtable_remove_h(parent_comp->hashtable, item->key, hash);
+
+        /* if keys are repeated at all, the next item with the same
+            key (if any) takes its place */
+        if (parent_comp->hashtable->len + 1 < jscon_size(item_parent)){
+            for (size_t i = item->index+1; i < parent_comp->num_branch; ++i){
+                jscon_item_t *branch = parent_comp->branch[i];
+                if (NULL != branch && STREQ(branch->key, item->key)){
+                    Jscon_composite_set(branch->key, branch);
+                    break;
+                }
+            }
+        }
+    }
 
-    /* remove tree references to the item */
-    comp_prev->next = comp_last->next;
+    /* leave its slot empty, the branches that follow it keep their
+        positions until the parent is compacted */
+    parent_comp->branch[item->index] = NULL;
+    ++parent_comp->num_deleted;
+    /* trailing slots can be dropped right away */
+    while (parent_comp->num_deleted && NULL == parent_comp->branch[parent_comp->num_branch-1]){
+        --parent_comp->num_branch;
+        --parent_comp->num_deleted;
+    }
 
-    /* remove item references to the tree */
     item->parent = NULL;
-    comp_last->next = NULL;
-    item->comp->prev = NULL;
+    item->index = 0;
 
     return item;
 }
@@ -314,6 +361,24 @@ jscon_delete(jscon_item_t *item, const char *key)
 }
 
 
+/* the first composite among item's branches, starting at index */
+static jscon_item_t*
+_jscon_composite_branch(jscon_item_t *item, size_t index)
+{
+    /* packed arrays elements are primitives */
+    if (IS_PACKED(item)) return NULL;
+
+    Jscon_composite_expand(item);
+    ASSERT_S(NULL == item->comp->source, "Can't iterate a frozen shared clone by its parents (use jscon_cursor_init())");
+    Jscon_composite_compact(item);
+    for (size_t i=index; i < item->comp->num_branch; ++i){
+        if (IS_COMPOSITE(item->comp->branch[i])){
+            return item->comp->branch[i];
+        }
+    }
+    return NULL;
+}
+
 /* reentrant function, works similar to strtok. the starting point is set
  *  by doing the function call before the main iteration loop, then
  *  consecutive function calls inside the loop will continue the iteration
@@ -334,16 +399,22 @@ jscon_iter_composite_r(jscon_item_t *item, jscon_item_t **p_current_item)
         return NULL;
     }
 
-    /* get next comp in line, if NULL it means there are no more
-     *  composite datatype items to iterate through */
-    jscon_composite_t *next_comp = (*p_current_item)->comp->next;
-    if (NULL == next_comp){
-        /* reach end of composite items */
-        return *p_current_item = NULL;
+    /* get next composite in preorder, either the first one nested
+     *  at the current item, or the first one following the current
+     *  item (or one of its ancestors) at its parent. if NULL it means
+     *  there are no more composite datatype items to iterate through */
+    jscon_item_t *current = *p_current_item;
+    jscon_item_t *next = _jscon_composite_branch(current, 0);
+    while (NULL == next && !IS_ROOT(current)){
+        jscon_item_t *parent = current->parent;
+
+        Jscon_composite_compact(parent); /* so that index is up to date */
+        next = _jscon_composite_branch(parent, current->index+1);
+
+        current = parent;
     }
 
-    /* update current_item and return next composite */
-    return *p_current_item = next_comp->p_item;
+    return *p_current_item = next;
 }
 
 /* return next (not yet accessed) item, by using item->comp->last_accessed_branch as the branch index */
@@ -351,6 +422,9 @@ static inline jscon_item_t*
 _jscon_push(jscon_item_t *item)
 {
     ASSERT_S(IS_COMPOSITE(item), jscon_strerror(JSCON_EXT__NOT_COMPOSITE, item));
+    Jscon_composite_expand(item);
+    ASSERT_S(NULL == item->comp->source, "Can't iterate a frozen shared clone by its parents (use jscon_cursor_init())");
+    Jscon_composite_compact(item);
     ASSERT_S(item->comp->last_accessed_branch < item->comp->num_branch, jscon_strerror(JSCON_INT__OVERFLOW, item->comp));
 
     ++item->comp->last_accessed_branch; /* update last_accessed_branch to next */
@@ -405,32 +479,66 @@ jscon_iter_next(jscon_item_t *item)
     return _jscon_push(item);
 }
 
-/* This is not the most effective way to clone a item, but it is
- *  the most reliable, because it automatically accounts for any
- *  new feature that might added in the future. By first stringfying the
- *  (to be cloned) Item and then parsing the resulting string into
- *  a new clone Item, it's guaranteed that it will be a perfect 
- *  clone, with its unique hashtable, strings, etc */
+/* copy the item's tree node by node, reusing its cached key hashes
+ *  to build the clone's hashtables */
 jscon_item_t*
-jscon_clone(jscon_item_t *item)
+jscon_clone(jscon_item_t *item){
+    return jscon_clone_ex(item, JSCON_CLONE_DEFAULT);
+}
+
+/* same as jscon_clone(), if JSCON_CLONE_SHARE is set and item is
+ *  frozen then its branches are only cloned once accessed, one level
+ *  at a time */
+jscon_item_t*
+jscon_clone_ex(jscon_item_t *item, int flags)
 {
     if (NULL == item) return NULL;
 
-    char *tmp_buffer = jscon_stringify(item, JSCON_ANY);
-    jscon_item_t *clone = jscon_parse(tmp_buffer);
-    free(tmp_buffer);
+    bool is_shared = (flags & JSCON_CLONE_SHARE) && IS_FROZEN(item);
+    jscon_item_t *clone = Jscon_item_clone(item, is_shared);
 
     if (NULL != item->key){
         clone->key = strdup(item->key);
         if (NULL == clone->key){
             jscon_destroy(clone);
-            clone = NULL;
+            return NULL;
         }
+        clone->key_len = item->key_len;
+        clone->key_hash = item->key_hash;
     }
 
     return clone;
 }
 
+/* start a new version of the frozen root, by cloning only the path
+ *  to the item at path (a key per nesting level), the rest of it is
+ *  shared with root. p_item is set to the item's writable clone,
+ *  the new version should be frozen once it's done being modified.
+ *  return NULL if there's no item at path */
+jscon_item_t*
+jscon_version_edit(jscon_item_t *root, const char *path[], size_t depth, jscon_item_t **p_item)
+{
+    ASSERT_S(IS_ROOT(root), "Can only version a tree from its root");
+    ASSERT_S(IS_FROZEN(root), "Can only version a frozen tree");
+
+    jscon_item_t *new_root = jscon_clone_ex(root, JSCON_CLONE_SHARE);
+
+    jscon_item_t *item = new_root;
+    for (size_t i=0; i < depth && NULL != item; ++i){
+        item = Jscon_composite_get(path[i], item);
+    }
+
+    if (NULL == item){
+        jscon_destroy(new_root);
+        return NULL;
+    }
+
+    if (NULL != p_item){
+        *p_item = item;
+    }
+    return new_root;
+}
+
 char*
 jscon_typeof(const jscon_item_t *item)
 {
@@ -489,14 +597,14 @@ int
 jscon_doublecmp(const jscon_item_t *item, const double d_number){
     ASSERT_S(JSCON_DOUBLE == item->type, jscon_strerror(JSCON_EXT__NOT_NUMBER, (void*)item));
 
-    return item->d_number == d_number;
+    return jscon_get_double(item) == d_number;
 }
 
 int
 jscon_intcmp(const jscon_item_t *item, const long long i_number){
     ASSERT_S(JSCON_INTEGER == item->type, jscon_strerror(JSCON_EXT__NOT_NUMBER, (void*)item));
 
-    return item->i_number == i_number;
+    return jscon_get_integer(item) == i_number;
 }
 
 jscon_item_t*
@@ -523,6 +631,50 @@ jscon_get_branch(jscon_item_t *item, const char *key)
     return Jscon_composite_get(key, item);
 }
 
+/* hash key once, for jscon_get_branch_k() lookups */
+jscon_key_t
+jscon_key(const char *key)
+{
+    ASSERT_S(NULL != key, "Key can't be NULL");
+
+    jscon_key_t new_key = { .str = key, .len = strlen(key), .hint = 0 };
+    new_key.hash = hashtable_genhash(key, new_key.len);
+
+    return new_key;
+}
+
+/* same as jscon_get_branch(), without hashing key. the branch at
+    key's hint is checked first (unless keys are repeated, as it might
+    be shadowed by a previous one), and the hint updated to the branch
+    found */
+jscon_item_t*
+jscon_get_branch_k(jscon_item_t *item, jscon_key_t *key)
+{
+    ASSERT_S(IS_COMPOSITE(item), jscon_strerror(JSCON_EXT__NOT_COMPOSITE, item));
+
+    Jscon_composite_expand(item);
+    if (NULL != item->comp->source){
+        item = item->comp->source;
+    }
+
+    jscon_composite_t *comp = item->comp;
+    if (key->hint < comp->num_branch && !Jscon_composite_has_repeats(item)){
+        jscon_item_t *branch = comp->branch[key->hint];
+        /* branch might have been dettached */
+        if (NULL != branch && NULL != branch->key && STREQ(branch->key, key->str)){
+            return branch;
+        }
+    }
+
+    size_t index;
+    jscon_item_t *branch = Jscon_composite_get_h(key->str, key->hash, item, &index);
+    if (NULL != branch){
+        key->hint = index;
+    }
+
+    return branch;
+}
+
 /* get origin item sibling by the relative index, if origin item is of index 3 (from parent's perspective), and relative index is -1, then this function will return item of index 2 (from parent's perspective) */
 jscon_item_t*
 jscon_get_sibling(const jscon_item_t* item, const size_t relative_index)
@@ -530,7 +682,8 @@ jscon_get_sibling(const jscon_item_t* item, const size_t relative_index)
     ASSERT_S(!IS_ROOT(item), "Item is root (has no siblings)");
 
     /* get parent's branch index of the origin item */
-    size_t item_index = jscon_get_index(item->parent, item->key);
+    Jscon_composite_compact(item->parent);
+    size_t item_index = item->index;
 
     if ((0 <= (int)(item_index + relative_index)) 
         && jscon_size(item->parent) > (item_index + relative_index)){
@@ -550,6 +703,13 @@ jscon_item_t*
 jscon_get_byindex(const jscon_item_t *item, const size_t index)
 {
     ASSERT_S(IS_COMPOSITE(item), jscon_strerror(JSCON_EXT__NOT_COMPOSITE, (void*)item));
+
+    Jscon_composite_expand((jscon_item_t*)item);
+    if (NULL != item->comp->source){
+        item = item->comp->source;
+    }
+
+    Jscon_composite_compact((jscon_item_t*)item);
     return (index < item->comp->num_branch) ? item->comp->branch[index] : NULL;
 }
 
@@ -562,16 +722,8 @@ jscon_get_index(const jscon_item_t *item, const char *key)
 
     if (NULL == lookup_item) return -1;
 
-    /* @todo currently this is O(n), a possible alternative
-     *  is adding a new attribute that stores the item's index */
-    for (size_t i=0; i < item->comp->num_branch; ++i){
-        if (lookup_item == item->comp->branch[i]){
-            return i;
-        }
-    }
-
-    ERROR("Item exists in hashtable but is not referenced by parent");
-    abort();
+    Jscon_composite_compact((jscon_item_t*)item);
+    return (long)lookup_item->index;
 }
 
 enum jscon_type
@@ -608,6 +760,11 @@ jscon_get_double(const jscon_item_t *item)
     if (NULL == item || JSCON_NULL == item->type) return 0.0;
 
     ASSERT_S(JSCON_DOUBLE == item->type, jscon_strerror(JSCON_EXT__NOT_NUMBER, (void*)item));
+
+    if (IS_LAZY_NUMBER(item)){
+        Jscon_lazynum_resolve((jscon_item_t*)item);
+        return item->lazynum->d_number;
+    }
     return item->d_number;
 }
 
@@ -617,12 +774,63 @@ jscon_get_integer(const jscon_item_t *item)
     if (NULL == item || JSCON_NULL == item->type) return 0;
 
     ASSERT_S(JSCON_INTEGER == item->type, jscon_strerror(JSCON_EXT__NOT_NUMBER, (void*)item));
+
+    if (IS_LAZY_NUMBER(item)){
+        Jscon_lazynum_resolve((jscon_item_t*)item);
+        return item->lazynum->i_number;
+    }
     return item->i_number;
 }
 
+/* fetch packed array vector, return false if item isn't a packed
+    array of the given type */
+static bool
+_jscon_get_packed(const jscon_item_t *item, enum jscon_type type, void **p_array, size_t *p_len)
+{
+    if (NULL == item || !IS_COMPOSITE(item) || !IS_PACKED(item)) return false;
+    if (type != item->comp->packed->type) return false;
+
+    *p_array = item->comp->packed->i_number; /* any member will do */
+    *p_len = item->comp->packed->len;
+
+    return true;
+}
+
+bool
+jscon_get_integers(const jscon_item_t *item, long long **p_array, size_t *p_len)
+{
+    void *array;
+    if (!_jscon_get_packed(item, JSCON_INTEGER, &array, p_len)) return false;
+
+    *p_array = array;
+    return true;
+}
+
+bool
+jscon_get_doubles(const jscon_item_t *item, double **p_array, size_t *p_len)
+{
+    void *array;
+    if (!_jscon_get_packed(item, JSCON_DOUBLE, &array, p_len)) return false;
+
+    *p_array = array;
+    return true;
+}
+
+bool
+jscon_get_booleans(const jscon_item_t *item, bool **p_array, size_t *p_len)
+{
+    void *array;
+    if (!_jscon_get_packed(item, JSCON_BOOLEAN, &array, p_len)) return false;
+
+    *p_array = array;
+    return true;
+}
+
 jscon_item_t*
 jscon_set_boolean(jscon_item_t *item, bool boolean)
 {
+    ASSERT_S(!IS_FROZEN(item), "Can't modify a frozen tree");
+
     item->boolean = boolean;
     return item;
 }
@@ -630,6 +838,8 @@ jscon_set_boolean(jscon_item_t *item, bool boolean)
 jscon_item_t*
 jscon_set_string(jscon_item_t *item, char *string)
 {
+    ASSERT_S(!IS_READ_ONLY(item), "Can't modify a read-only tree");
+
     if (item->string){
       free(item->string);
     }
@@ -638,9 +848,24 @@ jscon_set_string(jscon_item_t *item, char *string)
     return item;
 }
 
+/* lazy number text is outdated once a new value is set */
+static void
+_jscon_drop_lazynum(jscon_item_t *item)
+{
+    if (!IS_LAZY_NUMBER(item)) return;
+
+    /* memory block allocations aren't freed individually */
+    if (!IS_ARENA(item)) free(item->lazynum);
+    item->lazynum = NULL;
+    item->flags &= ~JSCON_ITEM_LAZY_NUMBER;
+}
+
 jscon_item_t*
 jscon_set_double(jscon_item_t *item, double d_number)
 {
+    ASSERT_S(!IS_FROZEN(item), "Can't modify a frozen tree");
+
+    _jscon_drop_lazynum(item);
     item->d_number = d_number;
     return item;
 }
@@ -648,6 +873,9 @@ jscon_set_double(jscon_item_t *item, double d_number)
 jscon_item_t*
 jscon_set_integer(jscon_item_t *item, long long i_number)
 {
+    ASSERT_S(!IS_FROZEN(item), "Can't modify a frozen tree");
+
+    _jscon_drop_lazynum(item);
     item->i_number = i_number;
     return item;
 }
@@ -0,0 +1,359 @@
+/*
+ * Copyright (c) 2020 Lucas Müller
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <unistd.h>
+#include <pthread.h>
+
+#include <libjscon.h>
+
+#include "jscon-common.h"
+#include "debug.h"
+
+
+#define JSCON_STREAM_CHUNK 65536 /* amount of bytes read at once */
+
+/* element boundaries scanning state, kept in between reads. works as
+    jscon-scanf.c skip_composite(), but can be resumed at a chunk's end
+    (the latter expects a nul-terminated, complete text) */
+struct _jscon_stream_scan_s {
+    size_t pos; /* next byte to be scanned */
+    size_t depth; /* nesting depth within current element */
+    bool in_string;
+    bool is_escaped;
+};
+
+struct jscon_array_stream_s {
+    int fd; /* -1 if reading from a buffer */
+    bool is_eof;
+
+    char *buffer; /* window containing current element */
+    size_t len; /* amount of valid bytes at window */
+    size_t size; /* window's capacity (0 if not owned) */
+
+    enum {
+        STREAM_BEGIN, /* array's '[' not reached yet */
+        STREAM_FIRST, /* right after array's '[' */
+        STREAM_ELEMENT, /* right after an element's ',' */
+        STREAM_END /* array's ']' reached */
+    } state;
+
+    size_t elem_start; /* current element's start at window */
+    struct _jscon_stream_scan_s scan;
+
+    /* read-ahead, a helper thread reads the next chunk while the
+        current one is being parsed */
+    bool has_thread;
+    pthread_t thread;
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    char *chunk;
+    ssize_t chunk_len; /* bytes read, 0 if eof, -1 on error */
+    bool is_chunk_ready;
+    bool is_closing;
+};
+
+static void*
+_jscon_stream_read_ahead(void *arg)
+{
+    jscon_array_stream_t *stream = arg;
+
+    pthread_mutex_lock(&stream->lock);
+    while (1){
+        while (stream->is_chunk_ready && !stream->is_closing){
+            pthread_cond_wait(&stream->cond, &stream->lock);
+        }
+        if (stream->is_closing) break;
+
+        pthread_mutex_unlock(&stream->lock);
+        ssize_t chunk_len = read(stream->fd, stream->chunk, JSCON_STREAM_CHUNK);
+        pthread_mutex_lock(&stream->lock);
+
+        stream->chunk_len = chunk_len;
+        stream->is_chunk_ready = true;
+        pthread_cond_broadcast(&stream->cond);
+
+        if (chunk_len <= 0) break; /* nothing left to read */
+    }
+    pthread_mutex_unlock(&stream->lock);
+
+    return NULL;
+}
+
+/* discard window's consumed bytes and append the next chunk to it,
+    return false if there's nothing left to read */
+static bool
+_jscon_stream_fill(jscon_array_stream_t *stream)
+{
+    if (stream->is_eof) return false;
+
+    /* 1st STEP: discard everything before current element */
+    size_t consumed = stream->elem_start;
+    if (consumed > 0){
+        memmove(stream->buffer, stream->buffer + consumed, stream->len - consumed);
+        stream->len -= consumed;
+        stream->scan.pos -= consumed;
+        stream->elem_start = 0;
+    }
+
+    /* 2nd STEP: make room for a chunk (and a nul terminator) */
+    if (stream->len + JSCON_STREAM_CHUNK + 1 > stream->size){
+        stream->size = 2 * stream->size + JSCON_STREAM_CHUNK + 1;
+
+        char *tmp = realloc(stream->buffer, stream->size);
+        ASSERT_S(NULL != tmp, jscon_strerror(JSCON_EXT__OUT_MEM, tmp));
+        stream->buffer = tmp;
+    }
+
+    /* 3rd STEP: read chunk straight from fd, or from read-ahead thread */
+    ssize_t chunk_len;
+    if (stream->has_thread){
+        pthread_mutex_lock(&stream->lock);
+        while (!stream->is_chunk_ready){
+            pthread_cond_wait(&stream->cond, &stream->lock);
+        }
+        chunk_len = stream->chunk_len;
+        if (chunk_len > 0){
+            memcpy(stream->buffer + stream->len, stream->chunk, chunk_len);
+        }
+        stream->is_chunk_ready = false;
+        pthread_cond_broadcast(&stream->cond);
+        pthread_mutex_unlock(&stream->lock);
+    }
+    else {
+        chunk_len = read(stream->fd, stream->buffer + stream->len, JSCON_STREAM_CHUNK);
+    }
+    ASSERT_S(chunk_len >= 0, "Couldn't read from file descriptor");
+
+    if (0 == chunk_len){
+        stream->is_eof = true;
+        return false;
+    }
+    stream->len += chunk_len;
+
+    return true;
+}
+
+/* scan the current element, return true and its end position (at its
+    trailing ',' or the array's ']') at p_end if found, or false if
+    more input is needed */
+static bool
+_jscon_stream_scan(jscon_array_stream_t *stream, size_t *p_end)
+{
+    struct _jscon_stream_scan_s *scan = &stream->scan;
+    for ( ; scan->pos < stream->len; ++scan->pos){
+        char c = stream->buffer[scan->pos];
+        if (scan->in_string){
+            if (scan->is_escaped)
+                scan->is_escaped = false;
+            else if ('\\' == c)
+                scan->is_escaped = true;
+            else if ('\"' == c)
+                scan->in_string = false;
+            continue;
+        }
+
+        switch (c){
+        case '\"':
+            scan->in_string = true;
+            break;
+        case '{': case '[':
+            ++scan->depth;
+            break;
+        case '}': case ']':
+            if (0 == scan->depth){ /* array's end */
+                *p_end = scan->pos;
+                return true;
+            }
+            --scan->depth;
+            break;
+        case ',':
+            if (0 == scan->depth){
+                *p_end = scan->pos;
+                return true;
+            }
+            break;
+        default:
+            break;
+        }
+    }
+    return false;
+}
+
+/* skip blank chars, filling the window as needed. return false if the
+    input has ended */
+static bool
+_jscon_stream_skip_blank(jscon_array_stream_t *stream)
+{
+    while (1){
+        while (stream->scan.pos < stream->len 
+                && IS_BLANK_CHAR(stream->buffer[stream->scan.pos]))
+        {
+            ++stream->scan.pos;
+        }
+        if (stream->scan.pos < stream->len) return true;
+
+        stream->elem_start = stream->scan.pos; /* nothing to keep */
+        if (!_jscon_stream_fill(stream)) return false;
+    }
+}
+
+static jscon_array_stream_t*
+_jscon_stream_init(int fd)
+{
+    jscon_array_stream_t *new_stream = calloc(1, sizeof *new_stream);
+    if (NULL == new_stream) return NULL;
+
+    new_stream->fd = fd;
+    new_stream->state = STREAM_BEGIN;
+
+    return new_stream;
+}
+
+/* open a stream over the top-level array read from fd, if read_ahead
+    is set the next chunk is read by a helper thread while the current
+    one is being parsed */
+jscon_array_stream_t*
+jscon_array_stream_open(int fd, bool read_ahead)
+{
+    jscon_array_stream_t *new_stream = _jscon_stream_init(fd);
+    if (NULL == new_stream) return NULL;
+
+    if (read_ahead){
+        new_stream->chunk = malloc(JSCON_STREAM_CHUNK);
+        if (NULL == new_stream->chunk) goto cleanupA;
+
+        pthread_mutex_init(&new_stream->lock, NULL);
+        pthread_cond_init(&new_stream->cond, NULL);
+        if (0 != pthread_create(&new_stream->thread, NULL, &_jscon_stream_read_ahead, new_stream))
+            goto cleanupB;
+
+        new_stream->has_thread = true;
+    }
+
+    return new_stream;
+
+cleanupB:
+    pthread_cond_destroy(&new_stream->cond);
+    pthread_mutex_destroy(&new_stream->lock);
+    free(new_stream->chunk);
+cleanupA:
+    free(new_stream);
+
+    return NULL;
+}
+
+/* open a stream over the top-level array contained in buffer */
+jscon_array_stream_t*
+jscon_array_stream_open_buffer(char *buffer, size_t len)
+{
+    jscon_array_stream_t *new_stream = _jscon_stream_init(-1);
+    if (NULL == new_stream) return NULL;
+
+    new_stream->buffer = buffer;
+    new_stream->len = len;
+    new_stream->is_eof = true;
+
+    return new_stream;
+}
+
+/* parse and return the array's next element, or NULL if there are
+    no elements left. the returned item must be freed with jscon_destroy() */
+jscon_item_t*
+jscon_array_stream_next(jscon_array_stream_t *stream)
+{
+    switch (stream->state){
+    case STREAM_END:
+        return NULL;
+    case STREAM_BEGIN:
+        if (!_jscon_stream_skip_blank(stream)) return NULL; /* empty input */
+
+        ASSERT_S('[' == stream->buffer[stream->scan.pos], jscon_strerror(JSCON_EXT__NOT_COMPOSITE, stream->buffer));
+        ++stream->scan.pos; /* skips '[' */
+
+        stream->state = STREAM_FIRST;
+        break;
+    default:
+        break;
+    }
+
+    /* 1st STEP: find the element's start */
+    ASSERT_S(_jscon_stream_skip_blank(stream), "Array is missing its ']' delim");
+    if (']' == stream->buffer[stream->scan.pos]){ /* empty array */
+        /* a ',' must be followed by an element */
+        ASSERT_S(STREAM_FIRST == stream->state, jscon_strerror(JSCON_EXT__INVALID_TOKEN, stream->buffer + stream->scan.pos));
+        stream->state = STREAM_END;
+        return NULL;
+    }
+    stream->elem_start = stream->scan.pos;
+
+    /* 2nd STEP: find the element's end */
+    size_t elem_end;
+    while (!_jscon_stream_scan(stream, &elem_end)){
+        ASSERT_S(_jscon_stream_fill(stream), "Array is missing its ']' delim");
+    }
+    ASSERT_S(elem_end > stream->elem_start, jscon_strerror(JSCON_EXT__INVALID_TOKEN, stream->buffer + elem_end));
+
+    /* 3rd STEP: make sure the span holds a single value, the parser
+        would ignore whatever comes after it (ex: [1 2]) */
+    size_t err_offset;
+    ASSERT_S(jscon_validate(stream->buffer + stream->elem_start, elem_end - stream->elem_start, &err_offset),
+        jscon_strerror(JSCON_EXT__INVALID_TOKEN, stream->buffer + stream->elem_start + err_offset));
+
+    /* 4th STEP: parse the element, in place */
+    char delim = stream->buffer[elem_end];
+    stream->buffer[elem_end] = '\0';
+    jscon_item_t *item = jscon_parse(stream->buffer + stream->elem_start);
+    stream->buffer[elem_end] = delim;
+
+    stream->scan = (struct _jscon_stream_scan_s){ .pos = elem_end + 1 };
+    stream->state = (']' == delim) ? STREAM_END : STREAM_ELEMENT;
+
+    return item;
+}
+
+void
+jscon_array_stream_close(jscon_array_stream_t *stream)
+{
+    if (stream->has_thread){
+        pthread_mutex_lock(&stream->lock);
+        stream->is_closing = true;
+        pthread_cond_broadcast(&stream->cond);
+        pthread_mutex_unlock(&stream->lock);
+
+        pthread_join(stream->thread, NULL);
+
+        pthread_cond_destroy(&stream->cond);
+        pthread_mutex_destroy(&stream->lock);
+        free(stream->chunk);
+    }
+
+    if (-1 != stream->fd){ /* window is owned */
+        free(stream->buffer);
+    }
+
+    free(stream);
+}
@@ -61,14 +61,21 @@ _jscon_utils_encode(char get_char, struct _jscon_utils_s *utils)
     ++utils->buffer_offset;
 }
 
-/* get string value to perform buffer method calls */
+/* get string value of known length to perform buffer method calls,
+      the whole string is handled at once instead of char by char */
 static void
-_jscon_utils_apply_string(char *string, struct _jscon_utils_s *utils)
+_jscon_utils_apply_nstring(const char *string, size_t len, struct _jscon_utils_s *utils)
 {
-    while ('\0' != *string){
-        (*utils->method)(*string,utils);
-        ++string;
+    if (&_jscon_utils_encode == utils->method){
+        memcpy(utils->buffer_base + utils->buffer_offset, string, len);
     }
+    utils->buffer_offset += len;
+}
+
+/* get string value to perform buffer method calls */
+static void
+_jscon_utils_apply_string(char *string, struct _jscon_utils_s *utils){
+    _jscon_utils_apply_nstring(string, strlen(string), utils);
 }
 
 /* converts double to string and store it in p_str */
@@ -127,14 +134,76 @@ _jscon_utils_apply_double(double d_number, struct _jscon_utils_s *utils)
     _jscon_utils_apply_string(get_strnum,utils); /* store value in utils */
 }
 
+/* converts integer to string and store it in p_str, return its length
+      (p_str is not nul-terminated) */
+static size_t
+_jscon_integer_tostr(const long long i_number, char p_str[MAX_INTEGER_DIG])
+{
+    /* work with the unsigned magnitude, so LLONG_MIN doesn't overflow */
+    unsigned long long magnitude = (i_number < 0)
+                                    ? 0ULL - (unsigned long long)i_number
+                                    : (unsigned long long)i_number;
+
+    char digits[MAX_INTEGER_DIG];
+    size_t num_digits = 0;
+    do {
+        digits[num_digits++] = '0' + (magnitude % 10);
+        magnitude /= 10;
+    } while (0 != magnitude);
+
+    size_t len = 0;
+    if (i_number < 0){
+        p_str[len++] = '-';
+    }
+    while (num_digits){
+        p_str[len++] = digits[--num_digits];
+    }
+
+    return len;
+}
+
 /* get int converted to string and then perform buffer method calls */
 static void
 _jscon_utils_apply_integer(long long i_number, struct _jscon_utils_s *utils)
 {
     char get_strnum[MAX_INTEGER_DIG];
-    snprintf(get_strnum, MAX_INTEGER_DIG-1, "%lld", i_number);
+    size_t len = _jscon_integer_tostr(i_number, get_strnum);
 
-    _jscon_utils_apply_string(get_strnum,utils); /* store value in utils */
+    _jscon_utils_apply_nstring(get_strnum, len, utils); /* store value in utils */
+}
+
+/* get packed array's elements converted to string, separated by
+      commas, and then perform buffer method calls. the vector is walked
+      in a single tight loop, without the per item dispatch */
+static void
+_jscon_utils_apply_packed(jscon_packed_t *packed, struct _jscon_utils_s *utils)
+{
+    switch (packed->type){
+    case JSCON_INTEGER:
+        for (size_t i=0; i < packed->len; ++i){
+            if (0 != i) (*utils->method)(',', utils);
+            _jscon_utils_apply_integer(packed->i_number[i], utils);
+        }
+        return;
+    case JSCON_DOUBLE:
+        for (size_t i=0; i < packed->len; ++i){
+            if (0 != i) (*utils->method)(',', utils);
+            _jscon_utils_apply_double(packed->d_number[i], utils);
+        }
+        return;
+    case JSCON_BOOLEAN:
+        for (size_t i=0; i < packed->len; ++i){
+            if (0 != i) (*utils->method)(',', utils);
+
+            if (packed->boolean[i])
+                _jscon_utils_apply_nstring("true", 4, utils);
+            else
+                _jscon_utils_apply_nstring("false", 5, utils);
+        }
+        return;
+    default:
+        ERROR("Unknown packed type found\n\tCode: %d", packed->type);
+    }
 }
 
 /* walk jscon item, by traversing its branches recursively,
@@ -169,9 +238,17 @@ _jscon_stringify_preorder(jscon_item_t *item, enum jscon_type type, struct _jsco
         _jscon_utils_apply_string("false", utils);
         break;
     case JSCON_DOUBLE:
+        if (IS_LAZY_NUMBER(item)){ /* source digits are copied verbatim */
+            _jscon_utils_apply_string(item->lazynum->text, utils);
+            break;
+        }
         _jscon_utils_apply_double(item->d_number, utils);
         break;
     case JSCON_INTEGER:
+        if (IS_LAZY_NUMBER(item)){
+            _jscon_utils_apply_string(item->lazynum->text, utils);
+            break;
+        }
         _jscon_utils_apply_integer(item->i_number, utils);
         break;
     case JSCON_STRING:
@@ -204,12 +281,31 @@ _jscon_stringify_preorder(jscon_item_t *item, enum jscon_type type, struct _jsco
         }
     }
 
+    /* packed arrays write their whole vector at once */
+    if (IS_PACKED(item)){
+        if (item->comp->packed->type & type){
+            _jscon_utils_apply_packed(item->comp->packed, utils);
+        }
+        (*utils->method)(']', utils);
+        return;
+    }
+
+    /* dettached branches leave empty slots behind */
+    Jscon_composite_compact(item);
+
+    /* shared clones are written from their source, so that they
+        don't have to be materialized */
+    jscon_composite_t *comp = item->comp;
+    if (NULL != comp->source){
+        comp = comp->source->comp;
+    }
+
     /* 5th STEP: find first item's branch that matches the given type, and 
         calls the write function on it */
     size_t first_index=0;
-    while (first_index < item->comp->num_branch){
-        if (jscon_typecmp(item->comp->branch[first_index], type) || IS_COMPOSITE(item->comp->branch[first_index])){
-            _jscon_stringify_preorder(item->comp->branch[first_index], type, utils);
+    while (first_index < comp->num_branch){
+        if (jscon_typecmp(comp->branch[first_index], type) || IS_COMPOSITE(comp->branch[first_index])){
+            _jscon_stringify_preorder(comp->branch[first_index], type, utils);
             break;
         }
         ++first_index;
@@ -217,13 +313,13 @@ _jscon_stringify_preorder(jscon_item_t *item, enum jscon_type type, struct _jsco
 
     /* 6th STEP: calls the write function on every consecutive branch
         that matches the type criteria, with an added comma before it */
-    for (size_t j = first_index+1; j < item->comp->num_branch; ++j){
+    for (size_t j = first_index+1; j < comp->num_branch; ++j){
         /* skips branch that don't fit the criteria */
         if (!jscon_typecmp(item, type) && !IS_COMPOSITE(item)){
             continue;
         }
         (*utils->method)(',',utils);
-        _jscon_stringify_preorder(item->comp->branch[j], type, utils);
+        _jscon_stringify_preorder(comp->branch[j], type, utils);
     }
 
     /* 7th STEP: write the composite's type item wrapper token */
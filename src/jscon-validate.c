@@ -0,0 +1,335 @@
+/*
+ * Copyright (c) 2020 Lucas Müller
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+
+#include <libjscon.h>
+
+#include "jscon-common.h"
+
+
+/* validation state, nothing is allocated: the composite stack is a
+    bitmask with 1 bit per nesting level (set if object, unset if array) */
+struct _jscon_validate_s {
+    const char *buffer; /* current position */
+    const char *end; /* one past the last byte */
+    size_t depth;
+    unsigned char is_object[MAX_NESTING_DEPTH / CHAR_BIT];
+};
+
+static void
+_jscon_validate_blank(struct _jscon_validate_s *vs)
+{
+    while (vs->buffer < vs->end && IS_JSON_WHITESPACE(*vs->buffer)){
+        ++vs->buffer;
+    }
+}
+
+static bool
+_jscon_validate_hex(const char *buffer)
+{
+    for (int i=0; i < 4; ++i){
+        if (!isxdigit((unsigned char)buffer[i])) return false;
+    }
+    return true;
+}
+
+/* validate a multibyte UTF-8 sequence as per RFC 3629 (no overlong
+    encodings, surrogates or codepoints above U+10FFFF) */
+static bool
+_jscon_validate_utf8(struct _jscon_validate_s *vs)
+{
+    const unsigned char *str = (const unsigned char*)vs->buffer;
+    size_t avail = vs->end - vs->buffer;
+
+    unsigned char lo = 0x80, hi = 0xBF; /* 2nd byte range */
+    size_t len;
+    if (str[0] >= 0xC2 && str[0] <= 0xDF){
+        len = 2;
+    }
+    else if (str[0] >= 0xE0 && str[0] <= 0xEF){
+        len = 3;
+        if (0xE0 == str[0]) lo = 0xA0;
+        else if (0xED == str[0]) hi = 0x9F;
+    }
+    else if (str[0] >= 0xF0 && str[0] <= 0xF4){
+        len = 4;
+        if (0xF0 == str[0]) lo = 0x90;
+        else if (0xF4 == str[0]) hi = 0x8F;
+    }
+    else {
+        return false;
+    }
+
+    if (avail < len) return false;
+    if (str[1] < lo || str[1] > hi) return false;
+    for (size_t i=2; i < len; ++i){
+        if ((str[i] & 0xC0) != 0x80) return false;
+    }
+
+    vs->buffer += len;
+    return true;
+}
+
+/* validate string starting at its double quotes */
+static bool
+_jscon_validate_string(struct _jscon_validate_s *vs)
+{
+    ++vs->buffer; /* skips opening double quotes */
+    while (1){
+        /* skips 8 bytes at a time while there's nothing to look into */
+        while (vs->end - vs->buffer >= 8){
+            uint64_t x = SWAR_LOAD(vs->buffer);
+            if (SWAR_HAS_BYTE(x, '\"') || SWAR_HAS_BYTE(x, '\\')
+                || SWAR_HAS_LESS(x, 0x20) || SWAR_HAS_HIGH(x))
+            {
+                break;
+            }
+            vs->buffer += 8;
+        }
+        if (vs->buffer == vs->end) return false;
+
+        unsigned char c = *vs->buffer;
+        if ('\"' == c){
+            ++vs->buffer; /* skips closing double quotes */
+            return true;
+        }
+        if (c < 0x20) return false; /* control chars must be escaped */
+        if (c >= 0x80){
+            if (!_jscon_validate_utf8(vs)) return false;
+            continue;
+        }
+        if ('\\' == c){
+            if (vs->end - vs->buffer < 2) return false;
+
+            switch (vs->buffer[1]){
+            case '\"': case '\\': case '/': case 'b':
+            case 'f': case 'n': case 'r': case 't':
+                vs->buffer += 2;
+                continue;
+            case 'u':
+                if (vs->end - vs->buffer < 6) return false;
+                if (!_jscon_validate_hex(vs->buffer + 2)) return false;
+                vs->buffer += 6;
+                continue;
+            default:
+                ++vs->buffer; /* error at escaped char */
+                return false;
+            }
+        }
+        ++vs->buffer;
+    }
+}
+
+static void
+_jscon_validate_digits(struct _jscon_validate_s *vs)
+{
+    while (vs->buffer < vs->end && isdigit((unsigned char)*vs->buffer)){
+        ++vs->buffer;
+    }
+}
+
+/* validate number as per RFC 8259 grammar:
+    [ minus ] int [ frac ] [ exp ] */
+static bool
+_jscon_validate_number(struct _jscon_validate_s *vs)
+{
+    if ('-' == *vs->buffer) ++vs->buffer;
+    if (vs->buffer == vs->end) return false;
+
+    if ('0' == *vs->buffer){ /* no leading zeroes allowed */
+        ++vs->buffer;
+    }
+    else if (isdigit((unsigned char)*vs->buffer)){
+        _jscon_validate_digits(vs);
+    }
+    else {
+        return false;
+    }
+
+    if (vs->buffer < vs->end && '.' == *vs->buffer){
+        ++vs->buffer;
+        if (vs->buffer == vs->end || !isdigit((unsigned char)*vs->buffer))
+            return false;
+        _jscon_validate_digits(vs);
+    }
+
+    if (vs->buffer < vs->end && ('e' == *vs->buffer || 'E' == *vs->buffer)){
+        ++vs->buffer;
+        if (vs->buffer < vs->end && ('+' == *vs->buffer || '-' == *vs->buffer))
+            ++vs->buffer;
+        if (vs->buffer == vs->end || !isdigit((unsigned char)*vs->buffer))
+            return false;
+        _jscon_validate_digits(vs);
+    }
+
+    return true;
+}
+
+static bool
+_jscon_validate_literal(struct _jscon_validate_s *vs, const char literal[], size_t len)
+{
+    if ((size_t)(vs->end - vs->buffer) < len) return false;
+    if (!STRNEQ(vs->buffer, literal, len)) return false;
+
+    vs->buffer += len;
+    return true;
+}
+
+static bool
+_jscon_validate_push(struct _jscon_validate_s *vs, bool is_object)
+{
+    if (MAX_NESTING_DEPTH == vs->depth) return false;
+
+    unsigned char mask = 1 << (vs->depth % CHAR_BIT);
+    if (is_object)
+        vs->is_object[vs->depth / CHAR_BIT] |= mask;
+    else
+        vs->is_object[vs->depth / CHAR_BIT] &= ~mask;
+
+    ++vs->depth;
+    ++vs->buffer; /* skips '{' or '[' */
+    return true;
+}
+
+static bool
+_jscon_validate_top_is_object(struct _jscon_validate_s *vs){
+    size_t top = vs->depth - 1;
+    return vs->is_object[top / CHAR_BIT] & (1 << (top % CHAR_BIT));
+}
+
+/* validate object key and its ':' separator */
+static bool
+_jscon_validate_key(struct _jscon_validate_s *vs)
+{
+    _jscon_validate_blank(vs);
+    if (vs->buffer == vs->end || '\"' != *vs->buffer) return false;
+    if (!_jscon_validate_string(vs)) return false;
+
+    _jscon_validate_blank(vs);
+    if (vs->buffer == vs->end || ':' != *vs->buffer) return false;
+    ++vs->buffer; /* skips ':' */
+
+    return true;
+}
+
+/* check that buffer contains a single RFC 8259 compliant JSON text,
+    nothing is allocated. if it doesn't, the offset of the first
+    invalid byte is stored at p_err_offset (may be NULL) */
+bool
+jscon_validate(const char *buffer, size_t len, size_t *p_err_offset)
+{
+    struct _jscon_validate_s vs = {
+        .buffer = buffer,
+        .end = buffer + len,
+    };
+
+    enum { VALUE, AFTER_VALUE } state = VALUE;
+    while (1){
+        _jscon_validate_blank(&vs);
+
+        if (VALUE == state){
+            if (vs.buffer == vs.end) goto validate_error;
+
+            bool is_valid;
+            switch (*vs.buffer){
+            case '{':
+                if (!_jscon_validate_push(&vs, true)) goto validate_error;
+
+                _jscon_validate_blank(&vs);
+                if (vs.buffer < vs.end && '}' == *vs.buffer){
+                    --vs.depth;
+                    ++vs.buffer; /* skips '}' */
+                    is_valid = true;
+                    break;
+                }
+                if (!_jscon_validate_key(&vs)) goto validate_error;
+                continue; /* expects property's value */
+            case '[':
+                if (!_jscon_validate_push(&vs, false)) goto validate_error;
+
+                _jscon_validate_blank(&vs);
+                if (vs.buffer < vs.end && ']' == *vs.buffer){
+                    --vs.depth;
+                    ++vs.buffer; /* skips ']' */
+                    is_valid = true;
+                    break;
+                }
+                continue; /* expects element's value */
+            case '\"':
+                is_valid = _jscon_validate_string(&vs);
+                break;
+            case 't':
+                is_valid = _jscon_validate_literal(&vs, "true", 4);
+                break;
+            case 'f':
+                is_valid = _jscon_validate_literal(&vs, "false", 5);
+                break;
+            case 'n':
+                is_valid = _jscon_validate_literal(&vs, "null", 4);
+                break;
+            default:
+                is_valid = _jscon_validate_number(&vs);
+                break;
+            }
+            if (!is_valid) goto validate_error;
+
+            state = AFTER_VALUE;
+            continue;
+        }
+
+        /* AFTER_VALUE */
+        if (0 == vs.depth){ /* root has been completed */
+            if (vs.buffer != vs.end) goto validate_error;
+            return true;
+        }
+        if (vs.buffer == vs.end) goto validate_error;
+
+        bool is_object = _jscon_validate_top_is_object(&vs);
+        switch (*vs.buffer){
+        case ',':
+            ++vs.buffer; /* skips ',' */
+            if (is_object && !_jscon_validate_key(&vs)) goto validate_error;
+            state = VALUE;
+            break;
+        case '}':
+        case ']':
+            if (is_object != ('}' == *vs.buffer)) goto validate_error;
+            --vs.depth;
+            ++vs.buffer; /* skips '}' or ']' */
+            break;
+        default:
+            goto validate_error;
+        }
+    }
+
+
+validate_error:
+    if (NULL != p_err_offset){
+        *p_err_offset = vs.buffer - buffer;
+    }
+    return false;
+}
@@ -0,0 +1,187 @@
+/*
+ * Copyright (c) 2020 Lucas Müller
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+/* contention benchmark for cdictionary_t, the sharded dictionary.
+ *  reader threads look up random keys while writer threads replace
+ *  and remove them, compared against a dictionary_t behind a
+ *  pthread_rwlock. values hold their own key, so that readers also
+ *  check they never see a value from a different key nor a freed one
+ *
+ *  usage: cdictionary_bench [num_reader] [num_writer] [seconds] */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdatomic.h>
+#include <assert.h>
+#include <time.h>
+#include <pthread.h>
+
+#include "hashtable.h"
+#include "cdictionary.h"
+
+#define NUM_KEY 10000
+#define NUM_SHARD 64
+
+static char keys[NUM_KEY][16];
+
+static atomic_bool is_running;
+
+/* the dictionary under test */
+static cdictionary_t *cdictionary;
+static dictionary_t *dictionary;
+static pthread_rwlock_t rwlock = PTHREAD_RWLOCK_INITIALIZER;
+
+struct worker_s {
+    pthread_t tid;
+    unsigned seed;
+    bool is_writer;
+    bool is_locked; /* dictionary_t instead of cdictionary_t */
+    unsigned long long num_op;
+};
+
+static unsigned
+xorshift(unsigned *p_seed)
+{
+    unsigned x = *p_seed;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    return *p_seed = x;
+}
+
+static void
+check_value(const char *key, const char *value)
+{
+    if (NULL != value && 0 != strcmp(key, value)){
+        fprintf(stderr, "key '%s' has value '%s'\n", key, value);
+        abort();
+    }
+}
+
+static void*
+worker_run(void *arg)
+{
+    struct worker_s *worker = arg;
+
+    while (atomic_load_explicit(&is_running, memory_order_relaxed)){
+        const char *key = keys[xorshift(&worker->seed) % NUM_KEY];
+
+        if (worker->is_writer){
+            bool is_remove = (0 == xorshift(&worker->seed) % 4);
+
+            if (worker->is_locked){
+                pthread_rwlock_wrlock(&rwlock);
+                if (is_remove)
+                    dictionary_remove(dictionary, key);
+                else
+                    dictionary_set(dictionary, key, strdup(key), &free);
+                pthread_rwlock_unlock(&rwlock);
+            }
+            else {
+                if (is_remove)
+                    cdictionary_remove(cdictionary, key);
+                else
+                    cdictionary_set(cdictionary, key, strdup(key), &free);
+            }
+        }
+        else {
+            if (worker->is_locked){
+                pthread_rwlock_rdlock(&rwlock);
+                check_value(key, dictionary_get(dictionary, key));
+                pthread_rwlock_unlock(&rwlock);
+            }
+            else {
+                unsigned token = cdictionary_enter(cdictionary);
+                check_value(key, cdictionary_get(cdictionary, key));
+                cdictionary_leave(cdictionary, token);
+            }
+        }
+        ++worker->num_op;
+    }
+
+    return NULL;
+}
+
+static void
+bench(const char *name, bool is_locked, int num_reader, int num_writer, int seconds)
+{
+    const int kNum_worker = num_reader + num_writer;
+    struct worker_s *workers = calloc(kNum_worker, sizeof *workers);
+    assert(NULL != workers);
+
+    atomic_store(&is_running, true);
+    for (int i=0; i < kNum_worker; ++i){
+        workers[i].seed = 2463534242u + i;
+        workers[i].is_writer = (i >= num_reader);
+        workers[i].is_locked = is_locked;
+        pthread_create(&workers[i].tid, NULL, &worker_run, &workers[i]);
+    }
+
+    struct timespec delay = { .tv_sec = seconds };
+    nanosleep(&delay, NULL);
+    atomic_store(&is_running, false);
+
+    unsigned long long num_read = 0, num_write = 0;
+    for (int i=0; i < kNum_worker; ++i){
+        pthread_join(workers[i].tid, NULL);
+        if (workers[i].is_writer)
+            num_write += workers[i].num_op;
+        else
+            num_read += workers[i].num_op;
+    }
+    free(workers);
+
+    fprintf(stdout, "%-12s reads: %12.0f/s  writes: %12.0f/s\n", name,
+            (double)num_read / seconds, (double)num_write / seconds);
+}
+
+int main(int argc, char *argv[])
+{
+    int num_reader = (argc > 1) ? atoi(argv[1]) : 4;
+    int num_writer = (argc > 2) ? atoi(argv[2]) : 1;
+    int seconds = (argc > 3) ? atoi(argv[3]) : 2;
+
+    for (int i=0; i < NUM_KEY; ++i){
+        snprintf(keys[i], sizeof keys[i], "key%d", i);
+    }
+
+    fprintf(stdout, "%d readers, %d writers, %d keys, %ds\n",
+            num_reader, num_writer, NUM_KEY, seconds);
+
+    dictionary = dictionary_init();
+    for (int i=0; i < NUM_KEY; ++i){
+        dictionary_set(dictionary, keys[i], strdup(keys[i]), &free);
+    }
+    bench("rwlock", true, num_reader, num_writer, seconds);
+    dictionary_destroy(dictionary);
+
+    cdictionary = cdictionary_init(NUM_SHARD);
+    for (int i=0; i < NUM_KEY; ++i){
+        cdictionary_set(cdictionary, keys[i], strdup(keys[i]), &free);
+    }
+    bench("cdictionary", false, num_reader, num_writer, seconds);
+    cdictionary_destroy(cdictionary);
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,147 @@
+/*
+ * Copyright (c) 2020 Lucas Müller
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+/* regression tests for jscon_reparse() and jscon_parse_update(),
+ *  which edit a parsed tree in place
+ *
+ *  usage: test_update */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+
+#include <libjscon.h>
+
+
+static void
+assert_text(jscon_item_t *root, const char *expected)
+{
+    char *text = jscon_stringify(root, JSCON_ANY);
+    assert(NULL != text);
+
+    if (0 != strcmp(text, expected)){
+        fprintf(stderr, "expected: %s\ngot: %s\n", expected, text);
+        abort();
+    }
+    free(text);
+}
+
+/* replace buffer's first occurrence of old with new, return its offset */
+static size_t
+edit_buffer(char buffer[], const char *old, const char *new)
+{
+    char *found = strstr(buffer, old);
+    assert(NULL != found);
+
+    size_t old_len = strlen(old), new_len = strlen(new);
+    memmove(found + new_len, found + old_len, strlen(found + old_len) + 1);
+    memcpy(found, new, new_len);
+
+    return found - buffer;
+}
+
+/* re-parsed spans keep the tree's parse flags */
+static void
+test_reparse_flags(void)
+{
+    jscon_parse_opt_t opt = { .flags = JSCON_PARSE_LAZY_NUMBER };
+
+    char buffer[64] = "{\"a\":[2.50,1.0],\"b\":0.10}";
+    jscon_item_t *root = jscon_parse_ex(buffer, &opt);
+    assert(NULL != root);
+
+    size_t offset = edit_buffer(buffer, "1.0", "7.00");
+    jscon_reparse(root, buffer, offset, strlen("1.0"), strlen("7.00"));
+    assert_text(root, "{\"a\":[2.50,7.00],\"b\":0.10}");
+
+    /* breaks the root's boundaries, re-parsed as a whole */
+    offset = edit_buffer(buffer, "}", ",\"c\":1.50}");
+    jscon_reparse(root, buffer, offset, 1, strlen(",\"c\":1.50}"));
+    assert_text(root, "{\"a\":[2.50,7.00],\"b\":0.10,\"c\":1.50}");
+
+    jscon_destroy(root);
+}
+
+/* values replaced by jscon_parse_update() keep the tree's parse flags */
+static void
+test_update_flags(void)
+{
+    jscon_parse_opt_t opt = { .flags = JSCON_PARSE_LAZY_NUMBER };
+
+    char buffer[] = "{\"a\":[2.50,1.0]}";
+    jscon_item_t *root = jscon_parse_ex(buffer, &opt);
+    assert(NULL != root);
+
+    char update[] = "{\"a\":[2.50,7.00,9.90]}";
+    jscon_parse_update(root, update, NULL);
+    assert_text(root, "{\"a\":[2.50,7.00,9.90]}");
+
+    jscon_destroy(root);
+}
+
+static jscon_item_t *changed[8];
+static size_t num_changed;
+
+static jscon_item_t*
+keep_changed(jscon_item_t *item)
+{
+    assert(num_changed < sizeof(changed) / sizeof *changed);
+    changed[num_changed++] = item;
+
+    return item;
+}
+
+/* a composite whose later key mismatches is replaced as a whole, the
+    branches it updated before that must not be reported */
+static void
+test_update_mismatch(void)
+{
+    char buffer[] = "{\"o\":{\"x\":1,\"y\":2},\"a\":[1,\"s\"],\"z\":3}";
+    jscon_item_t *root = jscon_parse(buffer);
+    assert(NULL != root);
+
+    num_changed = 0;
+    char update[] = "{\"o\":{\"x\":5,\"w\":2},\"a\":[7,\"s\",0],\"z\":4}";
+    size_t count = jscon_parse_update(root, update, &keep_changed);
+    assert_text(root, "{\"o\":{\"x\":5,\"w\":2},\"a\":[7,\"s\",0],\"z\":4}");
+
+    assert(3 == count && 3 == num_changed);
+    assert(changed[0] == jscon_get_branch(root, "o"));
+    assert(changed[1] == jscon_get_branch(root, "a"));
+    assert(changed[2] == jscon_get_branch(root, "z"));
+    assert(4 == jscon_get_integer(changed[2]));
+
+    jscon_destroy(root);
+}
+
+int main(void)
+{
+    test_reparse_flags();
+    test_update_flags();
+    test_update_mismatch();
+
+    fprintf(stdout, "ok\n");
+
+    return EXIT_SUCCESS;
+}
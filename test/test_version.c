@@ -0,0 +1,125 @@
+/*
+ * Copyright (c) 2020 Lucas Müller
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+/* regression tests for jscon_version_edit() and jscon_clone_ex(),
+ *  whose frozen trees share their unchanged parts
+ *
+ *  usage: test_version */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+
+#include <libjscon.h>
+
+
+/* items reached through a shared part can be navigated by their
+    parents, even once the version they belong to is destroyed */
+static void
+test_version_destroy_older(void)
+{
+    char buffer[] = "{\"a\":{\"b\":{\"c\":1},\"d\":2},\"f\":3}";
+
+    jscon_item_t *v1 = jscon_parse(buffer);
+    assert(NULL != v1);
+    assert(true == jscon_freeze(v1));
+
+    const char *path[] = {"f"};
+    jscon_item_t *item;
+    jscon_item_t *v2 = jscon_version_edit(v1, path, 1, &item);
+    assert(NULL != v2);
+    assert(3 == jscon_get_integer(item));
+    assert(true == jscon_freeze(v2));
+
+    jscon_destroy(v1);
+
+    jscon_item_t *a = jscon_get_branch(v2, "a");
+    jscon_item_t *b = jscon_get_branch(a, "b");
+    assert(NULL != b);
+
+    /* b belongs to the older version, so its parents lead there */
+    jscon_item_t *root = jscon_get_root(b);
+    assert(NULL != root && v2 != root);
+    assert(3 == jscon_get_integer(jscon_get_branch(root, "f")));
+    assert(jscon_get_parent(b) == jscon_get_branch(root, "a"));
+
+    jscon_item_t *d = jscon_get_sibling(b, 1);
+    assert(NULL != d && 2 == jscon_get_integer(d));
+    assert(1 == jscon_get_integer(jscon_get_byindex(b, 0)));
+
+    /* same for the items visited by a cursor */
+    jscon_cursor_t cursor;
+    jscon_cursor_init(&cursor, v2, JSCON_CURSOR_PREORDER);
+    size_t num_item = 0;
+    while (NULL != (item = jscon_cursor_next(&cursor))){
+        assert(NULL != jscon_get_root(item));
+        ++num_item;
+    }
+    jscon_cursor_cleanup(&cursor);
+    assert(5 == num_item);
+
+    jscon_destroy(v2);
+}
+
+/* same as above, for a template destroyed before its shared clone */
+static void
+test_clone_destroy_template(void)
+{
+    char buffer[] = "[{\"x\":[1,2]},{\"x\":[3,4]}]";
+
+    jscon_item_t *template = jscon_parse(buffer);
+    assert(NULL != template);
+    assert(true == jscon_freeze(template));
+
+    jscon_item_t *clone = jscon_clone_ex(jscon_get_byindex(template, 1), JSCON_CLONE_SHARE);
+    assert(NULL != clone);
+    assert(true == jscon_freeze(clone));
+    jscon_destroy(template);
+
+    jscon_item_t *x = jscon_get_branch(clone, "x");
+    assert(NULL != x);
+
+    jscon_item_t *root = jscon_get_root(x);
+    assert(NULL != root && clone != root);
+    assert(2 == jscon_size(root));
+    assert(jscon_get_sibling(jscon_get_parent(x), -1) == jscon_get_byindex(root, 0));
+
+    /* materialized clones keep the template alive as well */
+    jscon_item_t *copy = jscon_clone_ex(clone, JSCON_CLONE_SHARE);
+    jscon_destroy(clone);
+
+    assert(4 == jscon_get_integer(jscon_get_byindex(jscon_get_branch(copy, "x"), 1)));
+
+    jscon_destroy(copy);
+}
+
+int main(void)
+{
+    test_version_destroy_older();
+    test_clone_destroy_template();
+
+    fprintf(stdout, "ok\n");
+
+    return EXIT_SUCCESS;
+}